@@ -37,6 +37,11 @@
 // 2015/10/4 : implement ReadFromFilerId(char *buffer, int size, OpenFileId) 
 // 2015/10/6 : add if statement to prevent OpenFileForId crash
 // 2015/10/6 : Null the table index after closing file
+// 2026/10/17 : add FileForId(), for the Mmap syscall
+// 2026/10/17 : check ids against the size of the table, NumOpenFileIds:
+//              the executables kept open by address spaces take up
+//              UNIX file descriptors too
+// 2026/10/17 : add ReopenFileId(), so a mapped file has a handle of its own
 // end Record ----------------------------------------------------
 
 #ifndef FS_H
@@ -49,9 +54,14 @@
 #ifdef FILESYS_STUB 		// Temporarily implement file system calls as 
 				// calls to UNIX, until the real file system
 				// implementation is available
+const int NumOpenFileIds = 20;		// size of fileDescriptorTable
+
 class FileSystem {
   public:
-    FileSystem() { for (int i = 0; i < 20; i++) fileDescriptorTable[i] = NULL; }
+    FileSystem() {
+	for (int i = 0; i < NumOpenFileIds; i++)
+	    fileDescriptorTable[i] = NULL;
+    }
 
     bool Create(char *name) {
 	int fileDescriptor = OpenForWrite(name);
@@ -74,13 +84,17 @@ class FileSystem {
         if(fd == -1) { 
             return fd;
         }
+        if(fd >= NumOpenFileIds) {	// no room in the table
+            Close(fd);
+            return -1;
+        }
 
         fileDescriptorTable[fd] = new OpenFile(fd);
         return fd;
     }
 
     int WriteToFileId(char *buffer, int size, OpenFileId id) {
-        OpenFile *file = fileDescriptorTable[id];
+        OpenFile *file = FileForId(id);
         
         if(file == NULL) {
             return -1;
@@ -90,7 +104,7 @@ class FileSystem {
     }
 
     int ReadFromFileId(char *buffer, int size, OpenFileId id) {
-        OpenFile *file = fileDescriptorTable[id];
+        OpenFile *file = FileForId(id);
 
         if(file == NULL) {
             return -1;
@@ -101,7 +115,7 @@ class FileSystem {
     }
 
     int CloseFileId(OpenFileId id) {
-        OpenFile *file = fileDescriptorTable[id];
+        OpenFile *file = FileForId(id);
         if(file == NULL) {
             return 0;
         }
@@ -111,9 +125,26 @@ class FileSystem {
         return 1;
     }
 
+    OpenFile *FileForId(OpenFileId id) {
+        if ((id < 0) || (id >= NumOpenFileIds))
+            return NULL;
+        return fileDescriptorTable[id];	// NULL if it isn't open
+    }
+
+    OpenFile *ReopenFileId(OpenFileId id) {	// a handle of our own on it,
+        int fd;					// outside the table
+
+        if (FileForId(id) == NULL)
+            return NULL;
+        fd = Dup(id);
+        if (fd < 0)
+            return NULL;
+        return new OpenFile(fd);
+    }
+
     bool Remove(char *name) { return Unlink(name) == 0; }
 
-	OpenFile *fileDescriptorTable[20];
+	OpenFile *fileDescriptorTable[NumOpenFileIds];
 	
 };
 
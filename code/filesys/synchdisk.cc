@@ -63,6 +63,22 @@ SynchDisk::ReadSector(int sectorNumber, char* data)
     lock->Release();
 }
 
+//----------------------------------------------------------------------
+// SynchDisk::ReadSectors
+// 	Read "count" sectors, starting at "sectorNumber" and all on the
+//	same track, into a buffer, with one request to the disk.  Return
+//	only after the data has been read.
+//----------------------------------------------------------------------
+
+void
+SynchDisk::ReadSectors(int sectorNumber, int count, char* data)
+{
+    lock->Acquire();			// only one disk I/O at a time
+    disk->ReadRequest(sectorNumber, data, count);
+    semaphore->P();			// wait for interrupt
+    lock->Release();
+}
+
 //----------------------------------------------------------------------
 // SynchDisk::WriteSector
 // 	Write the contents of a buffer into a disk sector.  Return only
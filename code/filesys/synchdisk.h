@@ -39,11 +39,18 @@ class SynchDisk : public CallBackObj {
     					// Disk::ReadRequest/WriteRequest and
 					// then wait until the request is done.
     void WriteSector(int sectorNumber, char* data);
+    void ReadSectors(int sectorNumber, int count, char* data);
+					// Read "count" sectors in a row, on
+					// one track, as a single request
     
     void CallBack();			// Called by the disk device interrupt
 					// handler, to signal that the
 					// current disk operation is complete.
 
+    void Checkpoint(int fd) { disk->Checkpoint(fd); }
+    void Restore(int fd) { disk->Restore(fd); }
+					// Save/restore the raw disk
+
   private:
     Disk *disk;		  		// Raw disk device
     Semaphore *semaphore; 		// To synchronize requesting thread 
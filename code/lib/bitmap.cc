@@ -103,6 +103,7 @@ Bitmap::Test(int which) const
 // 	Return the number of the first bit which is clear.
 //	As a side effect, set the bit (mark it as in use).
 //	(In other words, find and allocate a bit.)
+//	Words with every bit set are skipped whole.
 //
 //	If no bits are clear, return -1.
 //----------------------------------------------------------------------
@@ -110,10 +111,15 @@ Bitmap::Test(int which) const
 int 
 Bitmap::FindAndSet() 
 {
-    for (int i = 0; i < numBits; i++) {
-	if (!Test(i)) {
-	    Mark(i);
-	    return i;
+    for (int w = 0; w < numWords; w++) {
+	if (map[w] == ~0U)
+	    continue;			// a word at a time past full words
+	for (int i = w * BitsInWord; i < min(numBits, (w + 1) * BitsInWord);
+									i++) {
+	    if (!Test(i)) {
+		Mark(i);
+		return i;
+	    }
 	}
     }
     return -1;
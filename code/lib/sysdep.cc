@@ -45,13 +45,14 @@
 #endif
 #ifdef DOS	// neither does DOS
 #define NO_MPROT
+#define NO_MMAP		// nor mmap
 #endif
 
 extern "C" {
 #include <signal.h>
 #include <sys/types.h>
 
-#ifndef NO_MPROT 
+#if !defined(NO_MPROT) || !defined(NO_MMAP)
 #include <sys/mman.h>
 #endif
 
@@ -247,6 +248,48 @@ DeallocBoundedArray(char *ptr, int size)
 }
 #endif
 
+//----------------------------------------------------------------------
+// AllocHostMemory
+// 	Return "size" bytes of zeroed memory, mapped anonymously, so the
+//	host only finds pages for the parts that are used.  Where there
+//	is no mmap, just allocate and zero it.
+//----------------------------------------------------------------------
+
+char *
+AllocHostMemory(int size)
+{
+#ifdef NO_MMAP
+    char *ptr = new char[size];
+
+    bzero(ptr, size);
+    return ptr;
+#else
+    void *ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, 
+					MAP_PRIVATE | MAP_ANON, -1, 0);
+
+    if (ptr == MAP_FAILED) {
+	perror("mmap");
+	Abort();
+    }
+    return (char *) ptr;
+#endif
+}
+
+//----------------------------------------------------------------------
+// DeallocHostMemory
+// 	Give back memory from AllocHostMemory.
+//----------------------------------------------------------------------
+
+void
+DeallocHostMemory(char *ptr, int size)
+{
+#ifdef NO_MMAP
+    delete [] ptr;
+#else
+    munmap(ptr, size);
+#endif
+}
+
 //----------------------------------------------------------------------
 // PollFile
 // 	Check open file or open socket to see if there are any 
@@ -299,17 +342,18 @@ PollFile(int fd)
 //----------------------------------------------------------------------
 // OpenForWrite
 // 	Open a file for writing.  Create it if it doesn't exist; truncate it 
-//	if it does already exist.  Return the file descriptor.
+//	if it does already exist.  Return the file descriptor, or -1 if
+//	it can't be opened and not "crashOnError".
 //
 //	"name" -- file name
 //----------------------------------------------------------------------
 
 int
-OpenForWrite(char *name)
+OpenForWrite(char *name, bool crashOnError)
 {
     int fd = open(name, O_RDWR|O_CREAT|O_TRUNC, 0666);
 
-    ASSERT(fd >= 0); 
+    ASSERT(!crashOnError || fd >= 0);
     return fd;
 }
 
@@ -409,6 +453,18 @@ Close(int fd)
     return retVal;
 }
 
+//----------------------------------------------------------------------
+// Dup
+// 	Return another file descriptor for the same open file, or -1 if
+//	there are no more.
+//----------------------------------------------------------------------
+
+int
+Dup(int fd)
+{
+    return dup(fd);
+}
+
 //----------------------------------------------------------------------
 // Unlink
 // 	Delete a file.
@@ -37,13 +37,18 @@ extern unsigned int RandomNumber();
 extern char *AllocBoundedArray(int size);
 extern void DeallocBoundedArray(char *p, int size);
 
+// Allocate, de-allocate zeroed memory straight from the host, which
+// need not supply the pages until they are touched
+extern char *AllocHostMemory(int size);
+extern void DeallocHostMemory(char *p, int size);
+
 // Check file to see if there are any characters to be read.
 // If no characters in the file, return without waiting.
 extern bool PollFile(int fd);
 
 // File operations: open/read/write/lseek/close, and check for error
 // For simulating the disk and the console devices.
-extern int OpenForWrite(char *name);
+extern int OpenForWrite(char *name, bool crashOnError = true);
 extern int OpenForReadWrite(char *name, bool crashOnError);
 extern void Read(int fd, char *buffer, int nBytes);
 extern int ReadPartial(int fd, char *buffer, int nBytes);
@@ -51,6 +56,7 @@ extern void WriteFile(int fd, char *buffer, int nBytes);
 extern void Lseek(int fd, int offset, int whence);
 extern int Tell(int fd);
 extern int Close(int fd);
+extern int Dup(int fd);
 extern bool Unlink(char *name);
 
 // Other C library routines that are used by Nachos.
@@ -0,0 +1,99 @@
+// cache.cc
+//	Routines to model a set-associative cache: see cache.h.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "cache.h"
+#include "debug.h"
+
+//----------------------------------------------------------------------
+// IsPowerOfTwo
+// 	Return TRUE if "n" is a positive power of 2.
+//----------------------------------------------------------------------
+
+static bool
+IsPowerOfTwo(int n)
+{
+    return (n > 0) && ((n & (n - 1)) == 0);
+}
+
+//----------------------------------------------------------------------
+// Cache::Cache
+// 	Initialize an empty cache.
+//
+//	"size" -- the number of bytes it holds
+//	"lineSize" -- the number of bytes loaded on each miss
+//	"ways" -- the number of lines in each set
+//----------------------------------------------------------------------
+
+Cache::Cache(int size, int lineSize, int ways)
+{
+    ASSERT(IsPowerOfTwo(size) && IsPowerOfTwo(lineSize) &&
+					IsPowerOfTwo(ways));
+    ASSERT(size >= lineSize * ways);
+
+    for (lineShift = 0; (1 << lineShift) < lineSize; lineShift++)
+	;
+    setMask = size / (lineSize * ways) - 1;
+    this->ways = ways;
+    tags = new unsigned int[size / lineSize];
+    hits = misses = 0;
+    Flush();
+}
+
+//----------------------------------------------------------------------
+// Cache::~Cache
+// 	De-allocate the tags.
+//----------------------------------------------------------------------
+
+Cache::~Cache()
+{
+    delete [] tags;
+}
+
+//----------------------------------------------------------------------
+// Cache::Flush
+// 	Empty the cache, e.g. because the memory behind it was replaced
+//	when restoring a checkpoint.  The counts are kept.
+//----------------------------------------------------------------------
+
+void
+Cache::Flush()
+{
+    for (unsigned int i = 0; i < (setMask + 1) * ways; i++)
+	tags[i] = 0;
+}
+
+//----------------------------------------------------------------------
+// Cache::Lookup
+// 	Look for "tag" in "set", other than in the most recently used
+//	entry (Access has already checked that one).  Either way, it
+//	becomes the most recently used entry; on a miss, the least
+//	recently used line is thrown out.  Return TRUE on a hit.
+//----------------------------------------------------------------------
+
+bool
+Cache::Lookup(unsigned int *set, unsigned int tag)
+{
+    bool hit = FALSE;
+    int i;
+
+    for (i = 1; i < ways; i++)
+	if (set[i] == tag) {
+	    hit = TRUE;
+	    break;
+	}
+    if (hit)
+	hits++;
+    else {
+	misses++;
+	i = ways - 1;			// evict the least recently used
+    }
+    for (; i > 0; i--)
+	set[i] = set[i - 1];
+    set[0] = tag;
+    return hit;
+}
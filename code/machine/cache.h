@@ -0,0 +1,75 @@
+// cache.h
+//	Data structures to model the first-level instruction and data
+//	caches of the simulated machine.
+//
+//	The caches hold no data -- mainMemory is still read and written
+//	directly -- only the tags of the lines they would hold, so we know
+//	whether each access would have hit.  Each miss stalls the CPU for
+//	a fixed number of ticks.  Both caches are set-associative, with
+//	LRU replacement; stores allocate a line just as loads do.
+//
+//	The caches are only modeled when Nachos is run with
+//	"-cache <size> <lineSize> <ways> <missPenalty>"; otherwise the
+//	machine emulation never looks at them.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef CACHE_H
+#define CACHE_H
+
+#include "copyright.h"
+#include "utility.h"
+
+// Hits and misses in the two caches, since some point in time: kept
+// for each thread, and for the whole run (see Machine::ChargeCaches).
+
+class CacheCounts {
+  public:
+    int instrHits, instrMisses;
+    int dataHits, dataMisses;
+};
+
+// The following class defines one cache.  The tags are kept in a
+// single array, a set after another, each set in order of last use;
+// an entry is the number of the line (physical address / lineSize)
+// plus one, so that 0 means empty.
+
+class Cache {
+  public:
+    Cache(int size, int lineSize, int ways);
+				// "size" bytes, in lines of "lineSize"
+				// bytes, "ways" lines to a set (all
+				// powers of 2)
+    ~Cache();			// de-allocate the tags
+
+    bool Access(unsigned int physAddr) {
+				// return TRUE if reading or writing
+				// "physAddr" hits, and load it if not
+	unsigned int line = physAddr >> lineShift;
+	unsigned int *set = &tags[(line & setMask) * ways];
+
+	if (set[0] == line + 1) {	// same line as last time
+	    hits++;
+	    return TRUE;
+	}
+	return Lookup(set, line + 1);
+    }
+
+    void Flush();		// empty the cache
+
+    int hits;			// accesses so far that hit
+    int misses;			// and that missed
+
+  private:
+    bool Lookup(unsigned int *set, unsigned int tag);
+				// the rest of Access
+
+    unsigned int *tags;		// numSets * ways entries
+    int lineShift;		// log2(lineSize)
+    unsigned int setMask;	// numSets - 1
+    int ways;
+};
+
+#endif // CACHE_H
@@ -71,12 +71,11 @@ ConsoleInput::CallBack()
   int readCount;
 
     ASSERT(incoming == EOF);
-    if (!PollFile(readFileNo)) { // nothing to be read
+    readCount = kernel->eventLog->ReadConsole(readFileNo, &c);
+    if (readCount < 0) { // nothing to be read
         // schedule the next time to poll for a packet
         kernel->interrupt->Schedule(this, ConsoleTime, ConsoleReadInt);
     } else { 
-    	// otherwise, try to read a character
-    	readCount = ReadPartial(readFileNo, &c, sizeof(char));
 	if (readCount == 0) {
 	   // this seems to happen at end of file, when the
 	   // console input is a regular file
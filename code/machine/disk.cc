@@ -106,26 +106,37 @@ PrintSector (bool writing, int sector, char *data)
 //	Note that a disk only allows an entire sector to be read/written,
 //	not part of a sector.
 //
+//	A read can also be of several sectors one after another on the
+//	same track: once the head gets to the first, the rest pass under
+//	it one per RotationTime, so there is only the one seek and
+//	rotational delay.
+//
 //	"sectorNumber" -- the disk sector to read/write
 //	"data" -- the bytes to be written, the buffer to hold the incoming bytes
+//	"count" -- how many sectors to read, starting at "sectorNumber"
 //----------------------------------------------------------------------
 
 void
-Disk::ReadRequest(int sectorNumber, char* data)
+Disk::ReadRequest(int sectorNumber, char* data, int count)
 {
-    int ticks = ComputeLatency(sectorNumber, FALSE);
+    int ticks = ComputeLatency(sectorNumber, FALSE) + 
+					(count - 1) * RotationTime;
 
     ASSERT(!active);				// only one request at a time
     ASSERT((sectorNumber >= 0) && (sectorNumber < NumSectors));
+    ASSERT((count >= 1) && 
+	((sectorNumber % SectorsPerTrack) + count <= SectorsPerTrack));
     
-    DEBUG(dbgDisk, "Reading from sector " << sectorNumber);
+    DEBUG(dbgDisk, "Reading from sector " << sectorNumber << ", " << 
+						count << " sectors");
     Lseek(fileno, SectorSize * sectorNumber + MagicSize, 0);
-    Read(fileno, data, SectorSize);
+    Read(fileno, data, SectorSize * count);
     if (debug->IsEnabled('d'))
-	PrintSector(FALSE, sectorNumber, data);
+	for (int i = 0; i < count; i++)
+	    PrintSector(FALSE, sectorNumber + i, data + i * SectorSize);
     
     active = TRUE;
-    UpdateLast(sectorNumber);
+    UpdateLast(sectorNumber + count - 1);	// same track, so same seek
     kernel->stats->numDiskReads++;
     kernel->interrupt->Schedule(this, ticks, DiskInt);
 }
@@ -162,6 +173,42 @@ Disk::CallBack ()
     callWhenDone->CallBack();
 }
 
+//----------------------------------------------------------------------
+// Disk::Checkpoint, Disk::Restore
+// 	Write the position of the disk head, what is in the track buffer,
+//	and the contents of every sector to the checkpoint file "fd", or
+//	read them back (overwriting the disk).  Only called when no
+//	request is in progress.
+//----------------------------------------------------------------------
+
+void
+Disk::Checkpoint(int fd)
+{
+    char *buffer = new char[NumSectors * SectorSize];
+
+    ASSERT(!active);
+    WriteFile(fd, (char *) &lastSector, sizeof(int));
+    WriteFile(fd, (char *) &bufferInit, sizeof(int));
+    Lseek(fileno, MagicSize, 0);
+    Read(fileno, buffer, NumSectors * SectorSize);
+    WriteFile(fd, buffer, NumSectors * SectorSize);
+    delete [] buffer;
+}
+
+void
+Disk::Restore(int fd)
+{
+    char *buffer = new char[NumSectors * SectorSize];
+
+    ASSERT(!active);
+    Read(fd, (char *) &lastSector, sizeof(int));
+    Read(fd, (char *) &bufferInit, sizeof(int));
+    Read(fd, buffer, NumSectors * SectorSize);
+    Lseek(fileno, MagicSize, 0);
+    WriteFile(fileno, buffer, NumSectors * SectorSize);
+    delete [] buffer;
+}
+
 //----------------------------------------------------------------------
 // Disk::TimeToSeek()
 //	Returns how long it will take to position the disk head over the correct
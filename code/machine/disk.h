@@ -60,16 +60,23 @@ class Disk : public CallBackObj {
 					// when each request completes.
     ~Disk();				// Deallocate the disk.
     
-    void ReadRequest(int sectorNumber, char* data);
+    void ReadRequest(int sectorNumber, char* data, int count = 1);
     					// Read/write an single disk sector.
 					// These routines send a request to 
     					// the disk and return immediately.
     					// Only one request allowed at a time!
+					// A read may ask for "count" sectors
+					// in a row, all on one track.
     void WriteRequest(int sectorNumber, char* data);
 
     void CallBack();			// Invoked when disk request 
 					// finishes. In turn calls, callWhenDone.
 
+    void Checkpoint(int fd);		// Save the disk's contents and the
+    void Restore(int fd);		// position of its head to/from the
+					// UNIX file "fd", or read them back.
+					// The disk must be idle.
+
     int ComputeLatency(int newSector, bool writing);	
     					// Return how long a request to 
 					// newSector will take: 
@@ -0,0 +1,296 @@
+// eventlog.cc
+//	Routines to record external events, and to replay them.
+//
+//	The log starts with a magic number; then each event is the time
+//	since the previous one and its kind, followed by what came in:
+//
+//	RandomEvent		the number
+//	ConsoleCharEvent	the character
+//	ConsoleEOFEvent		nothing
+//	NetworkEvent		the packet's length (less any zero bytes
+//				at the end), then the packet
+//
+//	Numbers are written 7 bits to a byte, low bits first, with the
+//	top bit set in every byte but the last, so most take one or two
+//	bytes.  Console and network polls that find nothing are not
+//	logged: when replaying, a poll finds something exactly when the
+//	next logged event is of its kind and due now.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "eventlog.h"
+#include "main.h"
+
+const int EventLogMagic = 0x4e455654;		// "NEVT"
+const int EventLogBufferSize = 4096;		// bytes kept before writing
+
+//----------------------------------------------------------------------
+// EventLog::EventLog
+// 	Start recording or replaying external events.
+//
+//	"mode" -- whether to record, replay, or just pass events through
+//	"fileName" -- the UNIX file holding the log (unused with LogOff)
+//----------------------------------------------------------------------
+
+EventLog::EventLog(EventLogMode mode, char *fileName)
+{
+    int magic;
+
+    this->mode = mode;
+    this->fileName = fileName;
+    buffer = NULL;
+    length = position = 0;
+    lastTick = 0;
+    nextKind = EndOfLog;
+
+    if (mode == LogRecord) {
+	fd = OpenForWrite(fileName);
+	buffer = new char[EventLogBufferSize];
+	magic = EventLogMagic;
+	WriteFile(fd, (char *) &magic, sizeof(int));
+    } else if (mode == LogReplay) {
+	fd = OpenForReadWrite(fileName, TRUE);
+	Lseek(fd, 0, 2);
+	length = Tell(fd);
+	Lseek(fd, 0, 0);
+	buffer = new char[length];
+	Read(fd, buffer, length);
+	Close(fd);
+	if ((length < (int) sizeof(int)) ||
+		(*(int *) buffer != EventLogMagic)) {
+	    cerr << fileName << " is not an event log\n";
+	    Abort();
+	}
+	position = sizeof(int);
+	ReadHeader();
+    }
+}
+
+//----------------------------------------------------------------------
+// EventLog::~EventLog
+// 	Write out the rest of the log, if recording.
+//----------------------------------------------------------------------
+
+EventLog::~EventLog()
+{
+    if (mode == LogRecord) {
+	WriteFile(fd, buffer, length);
+	Close(fd);
+    }
+    delete [] buffer;
+}
+
+//----------------------------------------------------------------------
+// EventLog::Random
+// 	Return a pseudo-random number: from the log, if replaying.
+//	Random numbers are only ever asked for at the same points of a
+//	repeated run, so if the log doesn't have one now, the run has
+//	diverged from the recorded one.
+//----------------------------------------------------------------------
+
+unsigned int
+EventLog::Random()
+{
+    unsigned int value;
+
+    if (mode == LogReplay) {
+	if (!Replay(RandomEvent)) {
+	    cerr << "Replay diverged from " << fileName << " at time " <<
+				kernel->stats->totalTicks << "\n";
+	    Abort();
+	}
+	value = GetNumber();
+	ReadHeader();
+	return value;
+    }
+    value = RandomNumber();
+    if (mode == LogRecord) {
+	Record(RandomEvent);
+	PutNumber(value);
+    }
+    return value;
+}
+
+//----------------------------------------------------------------------
+// EventLog::ReadConsole
+// 	Poll the console input, and read a character if there is one.
+//	Return -1 if there is nothing to read, otherwise the number of
+//	characters read into "c" (0 at end of file).
+//
+//	"fd" -- the UNIX file simulating the keyboard
+//	"c" -- where to put the character
+//----------------------------------------------------------------------
+
+int
+EventLog::ReadConsole(int fd, char *c)
+{
+    int count;
+
+    if (mode == LogReplay) {
+	if (Replay(ConsoleCharEvent)) {
+	    *c = GetByte();
+	    ReadHeader();
+	    return 1;
+	}
+	if (Replay(ConsoleEOFEvent)) {
+	    ReadHeader();
+	    return 0;
+	}
+	return -1;
+    }
+    if (!PollFile(fd))
+	return -1;
+    count = ReadPartial(fd, c, sizeof(char));
+    if (mode == LogRecord) {
+	if (count == 0)
+	    Record(ConsoleEOFEvent);
+	else {
+	    Record(ConsoleCharEvent);
+	    PutByte(*c);
+	}
+    }
+    return count;
+}
+
+//----------------------------------------------------------------------
+// EventLog::ReadNetwork
+// 	Poll the network, and read a packet if there is one.  Return
+//	TRUE if one was read.
+//
+//	"sock" -- the UNIX socket the packets come in on
+//	"buffer", "size" -- where to put the packet, and how big it is
+//----------------------------------------------------------------------
+
+bool
+EventLog::ReadNetwork(int sock, char *buffer, int size)
+{
+    int n, i;
+
+    if (mode == LogReplay) {
+	if (!Replay(NetworkEvent))
+	    return FALSE;
+	n = GetNumber();
+	ASSERT(n <= size);
+	for (i = 0; i < size; i++)
+	    buffer[i] = (i < n) ? GetByte() : 0;
+	ReadHeader();
+	return TRUE;
+    }
+    if (!PollSocket(sock))
+	return FALSE;
+    ReadFromSocket(sock, buffer, size);
+    if (mode == LogRecord) {
+	for (n = size; (n > 0) && (buffer[n - 1] == 0); n--)
+	    ;			// packets are padded with zeroes
+	Record(NetworkEvent);
+	PutNumber(n);
+	for (i = 0; i < n; i++)
+	    PutByte(buffer[i]);
+    }
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// EventLog::Record
+// 	Log that an event of kind "kind" is happening now.  What came in
+//	is appended by the caller.
+//----------------------------------------------------------------------
+
+void
+EventLog::Record(EventKind kind)
+{
+    int now = kernel->stats->totalTicks;
+
+    PutNumber(now - lastTick);
+    PutByte((char) kind);
+    lastTick = now;
+}
+
+//----------------------------------------------------------------------
+// EventLog::PutByte, EventLog::PutNumber
+// 	Append to the log, writing the buffer out whenever it fills up.
+//----------------------------------------------------------------------
+
+void
+EventLog::PutByte(char byte)
+{
+    if (length == EventLogBufferSize) {
+	WriteFile(fd, buffer, length);
+	length = 0;
+    }
+    buffer[length++] = byte;
+}
+
+void
+EventLog::PutNumber(unsigned int n)
+{
+    while (n >= 0x80) {
+	PutByte((char) ((n & 0x7f) | 0x80));
+	n >>= 7;
+    }
+    PutByte((char) n);
+}
+
+//----------------------------------------------------------------------
+// EventLog::Replay
+// 	If the next event in the log is of kind "kind", and is due now,
+//	consume it (the caller then reads what came in) and return TRUE.
+//----------------------------------------------------------------------
+
+bool
+EventLog::Replay(EventKind kind)
+{
+    if ((nextKind != kind) || (nextTick != kernel->stats->totalTicks))
+	return FALSE;
+    lastTick = nextTick;
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// EventLog::ReadHeader
+// 	Decode when the next event in the log happens, and its kind.  At
+//	the end of the log, carry on with the real devices.
+//----------------------------------------------------------------------
+
+void
+EventLog::ReadHeader()
+{
+    if (position == length) {
+	DEBUG(dbgInt, "End of event log " << fileName);
+	nextKind = EndOfLog;
+	mode = LogOff;
+	return;
+    }
+    nextTick = lastTick + GetNumber();
+    nextKind = (EventKind) GetByte();
+}
+
+//----------------------------------------------------------------------
+// EventLog::GetByte, EventLog::GetNumber
+// 	Take the next byte or number from the log being replayed.
+//----------------------------------------------------------------------
+
+char
+EventLog::GetByte()
+{
+    ASSERT(position < length);		// truncated log
+    return buffer[position++];
+}
+
+unsigned int
+EventLog::GetNumber()
+{
+    unsigned int n = 0;
+    int shift = 0;
+    char byte;
+
+    do {
+	byte = GetByte();
+	n |= (unsigned int) (byte & 0x7f) << shift;
+	shift += 7;
+    } while (byte & 0x80);
+    return n;
+}
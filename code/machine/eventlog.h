@@ -0,0 +1,83 @@
+// eventlog.h
+//	Data structures for recording, and later replaying, everything
+//	that comes into the simulation from outside: pseudo-random
+//	numbers (used for random time slices and lost packets),
+//	characters typed at the console, and packets arriving from the
+//	network.
+//
+//	Each event is logged with the simulated time it happened at.
+//	When replaying, the devices are handed the logged events at the
+//	same times instead of asking the host, so a run can be repeated
+//	exactly -- for instance, to profile a slow one.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef EVENTLOG_H
+#define EVENTLOG_H
+
+#include "copyright.h"
+#include "utility.h"
+
+// What to do with external events.
+
+enum EventLogMode { LogOff, LogRecord, LogReplay };
+
+// The kinds of event in a log.
+
+enum EventKind { RandomEvent, ConsoleCharEvent, ConsoleEOFEvent,
+		 NetworkEvent, EndOfLog };
+
+// The following class defines the log.  With LogOff, every routine
+// just asks the host, as the devices used to do themselves.
+
+class EventLog {
+  public:
+    EventLog(EventLogMode mode, char *fileName);
+				// Start recording to, or replaying from,
+				// the UNIX file "fileName"
+    ~EventLog();		// Write out anything still buffered
+
+    unsigned int Random();	// RandomNumber(), recorded or replayed
+
+    int ReadConsole(int fd, char *c);
+				// Poll the console input "fd": -1 if there
+				// is nothing to read, otherwise the number
+				// of characters read into "c" (0 at EOF)
+
+    bool ReadNetwork(int sock, char *buffer, int size);
+				// Poll the socket "sock": if a packet
+				// of "size" bytes is there, read it into
+				// "buffer" and return TRUE
+
+    bool IsReplaying() { return mode == LogReplay; }
+				// If so, nothing is really sent anywhere
+
+  private:
+    void Record(EventKind kind);	// Log that "kind" happened now
+    void PutByte(char byte);		// Append to the log
+    void PutNumber(unsigned int n);	// ... in as few bytes as we can
+
+    bool Replay(EventKind kind);	// If the next logged event is a
+					// "kind" now, consume it
+    void ReadHeader();			// Decode the next event's time
+					// and kind
+    char GetByte();			// Take from the log
+    unsigned int GetNumber();
+
+    EventLogMode mode;
+    char *fileName;
+    int fd;			// UNIX file the log is in
+
+    char *buffer;		// When recording: the part of the log not
+    int length;			// yet written out.  When replaying: the
+    int position;		// whole log, and where we are in it.
+
+    int lastTick;		// When the last event happened; times are
+				// logged as the difference from this
+    int nextTick;		// When replaying: the next event's time
+    EventKind nextKind;		// and kind
+};
+
+#endif // EVENTLOG_H
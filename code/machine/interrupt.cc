@@ -28,10 +28,18 @@
 // 2015/10/5 : Add comment to OpenFile, WriteToFileId, CloseFileId, ReadFromFileId
 // 2015/10/8 : modify PrintInt flow
 // 2015/10/13: modify PrintInt flow again
+// 2026/10/17: add AdvanceTicks(int count) for the basic-block engine
+// 2026/10/17: add NextDue(), for running user code in batches
+// 2026/10/17: Halt() writes out the user program profile, if any
+// 2026/10/17: add IsPending(), Checkpoint() and Restore(), for -ckpt
+// 2026/10/17: Halt() charges the running thread's cache hits and misses
+// 2026/10/17: Halt() says which page replacement policy was used (-pr)
 // end Record ----------------------------------------------------
 
 #include "copyright.h"
 #include "interrupt.h"
+#include "profile.h"
+#include "frametable.h"
 #include "main.h"
 
 // String definitions for debugging messages
@@ -39,7 +47,7 @@
 static char *intLevelNames[] = { "off", "on"};
 static char *intTypeNames[] = { "timer", "disk", "console write", 
 			"console read", "network send", 
-			"network recv"};
+			"network recv", "switch"};
 
 //----------------------------------------------------------------------
 // PendingInterrupt::PendingInterrupt
@@ -156,17 +164,30 @@ Interrupt::SetLevel(IntStatus now)
 //----------------------------------------------------------------------
 void
 Interrupt::OneTick()
+{
+    AdvanceTicks(1);
+}
+
+//----------------------------------------------------------------------
+// Interrupt::AdvanceTicks
+// 	Same as OneTick, but advance simulated time by "count" ticks
+//	before checking for pending interrupts.  Used to charge a whole
+//	basic block of user instructions at once; any interrupt that
+//	falls due inside the block is taken at its end.
+//----------------------------------------------------------------------
+void
+Interrupt::AdvanceTicks(int count)
 {
     MachineStatus oldStatus = status;
     Statistics *stats = kernel->stats;
 
 // advance simulated time
     if (status == SystemMode) {
-        stats->totalTicks += SystemTick;
-	stats->systemTicks += SystemTick;
+        stats->totalTicks += SystemTick * count;
+	stats->systemTicks += SystemTick * count;
     } else {
-	stats->totalTicks += UserTick;
-	stats->userTicks += UserTick;
+	stats->totalTicks += UserTick * count;
+	stats->userTicks += UserTick * count;
     }
     DEBUG(dbgInt, "== Tick " << stats->totalTicks << " ==");
 // check any pending interrupts are now ready to fire
@@ -185,6 +206,22 @@ Interrupt::OneTick()
     }
 }
 
+//----------------------------------------------------------------------
+// Interrupt::NextDue
+// 	Return the time the next pending interrupt is due, or -1 if there
+//	are none.  Machine::Run uses this to run user instructions in
+//	batches, without calling OneTick after each: nothing can happen
+//	before then unless the user program traps to the kernel.
+//----------------------------------------------------------------------
+
+int
+Interrupt::NextDue()
+{
+    if (pending->IsEmpty())
+	return -1;
+    return pending->Front()->when;
+}
+
 //----------------------------------------------------------------------
 // Interrupt::YieldOnReturn
 // 	Called from within an interrupt handler, to cause a context switch
@@ -245,7 +282,11 @@ Interrupt::Halt()
 {
     cout << "Machine halting!\n\n";
     cout << "This is halt\n";
+    kernel->machine->ChargeCaches(&kernel->currentThread->cacheCounts);
     kernel->stats->Print();
+    cout << "Page replacement: " << kernel->frameTable->PolicyName() << "\n";
+    if (kernel->machine->profile != NULL)
+	kernel->machine->profile->Report();
     delete kernel;	// Never returns.
 }
 
@@ -443,6 +484,97 @@ Interrupt::DumpState()
     cout << "\nEnd of pending interrupts\n";
 }
 
+//----------------------------------------------------------------------
+// Interrupt::IsPending
+// 	Return TRUE if an interrupt of kind "type" is scheduled.  Used to
+//	tell whether a device operation is still in progress.
+//----------------------------------------------------------------------
+
+bool
+Interrupt::IsPending(IntType type)
+{
+    ListIterator<PendingInterrupt *> iter(pending);
+
+    for (; !iter.IsDone(); iter.Next())
+	if (iter.Item()->type == type)
+	    return TRUE;
+    return FALSE;
+}
+
+//----------------------------------------------------------------------
+// Interrupt::Checkpoint
+// 	Write the kind of each pending interrupt, and when it is due,
+//	to the checkpoint file "fd".
+//
+//	The objects to call back are not saved -- they are host pointers.
+//	Instead, Restore matches each saved interrupt with the one the
+//	same device scheduled when the restoring kernel started up.
+//----------------------------------------------------------------------
+
+void
+Interrupt::Checkpoint(int fd)
+{
+    ListIterator<PendingInterrupt *> iter(pending);
+    int num = pending->NumInList();
+
+    WriteFile(fd, (char *) &num, sizeof(int));
+    for (; !iter.IsDone(); iter.Next()) {
+	WriteFile(fd, (char *) &iter.Item()->type, sizeof(IntType));
+	WriteFile(fd, (char *) &iter.Item()->when, sizeof(int));
+    }
+}
+
+//----------------------------------------------------------------------
+// Interrupt::Restore
+// 	Re-time the pending interrupts to match those in the checkpoint
+//	file "fd".  Each one pending now takes the due time of the first
+//	unused saved interrupt of the same kind; one with no match keeps
+//	its distance from "ticksBefore", the time before the checkpoint's
+//	Statistics were restored.  Saved interrupts with no device to
+//	call back are dropped.
+//----------------------------------------------------------------------
+
+void
+Interrupt::Restore(int fd, int ticksBefore)
+{
+    SortedList<PendingInterrupt *> *old = pending;
+    IntType *types;
+    int *whens;
+    int num, i;
+
+    Read(fd, (char *) &num, sizeof(int));
+    types = new IntType[num];
+    whens = new int[num];
+    for (i = 0; i < num; i++) {
+	Read(fd, (char *) &types[i], sizeof(IntType));
+	Read(fd, (char *) &whens[i], sizeof(int));
+    }
+
+    pending = new SortedList<PendingInterrupt *>(PendingCompare);
+    while (!old->IsEmpty()) {
+	PendingInterrupt *next = old->RemoveFront();
+
+	for (i = 0; i < num; i++)
+	    if (types[i] == next->type)
+		break;
+	if (i < num) {
+	    next->when = whens[i];
+	    types[i] = (IntType) -1;		// used up
+	} else
+	    next->when += kernel->stats->totalTicks - ticksBefore;
+	pending->Insert(next);
+    }
+    for (i = 0; i < num; i++) {
+	if (types[i] != (IntType) -1) {
+	    DEBUG(dbgInt, "Dropping checkpointed interrupt " << 
+				intTypeNames[types[i]] << " at " << whens[i]);
+	}
+    }
+    delete old;
+    delete [] types;
+    delete [] whens;
+}
+
 void
 Interrupt::PrintInt(int number)
 {
@@ -36,6 +36,8 @@
 // 2015/10/4 : define WriteToFileId(char *buffer, int size, OpenFileId id) 
 // 2015/10/4 : define CloseFileId(OpenFileId id)
 // 2015/10/4 : define ReadFromFileId(char *buffer, int size, OpenFileId id)
+// 2026/10/17: define AdvanceTicks(int count)
+// 2026/10/17: define IsPending(), Checkpoint() and Restore()
 // end Record ----------------------------------------------------
 
 #ifndef INTERRUPT_H
@@ -120,6 +122,14 @@ class Interrupt {
 
     void DumpState();		// Print interrupt state
     
+    bool IsPending(IntType type);	// is an interrupt of this kind
+				// scheduled?
+    void Checkpoint(int fd);	// save when each pending interrupt is due
+    void Restore(int fd, int ticksBefore);
+				// re-time the pending interrupts to match
+				// a checkpoint; "ticksBefore" is the time
+				// before the checkpoint's Statistics were
+				// restored
 
     // NOTE: the following are internal to the hardware simulation code.
     // DO NOT call these directly.  I should make them "private",
@@ -132,6 +142,11 @@ class Interrupt {
     				// by the hardware device simulators.
     
     void OneTick();       	// Advance simulated time
+    void AdvanceTicks(int count);
+				// Advance simulated time by "count"
+				// ticks at once
+    int NextDue();		// When the next pending interrupt is
+				// due, or -1 if there is none
     void SliceForward();
 
   private:
@@ -9,8 +9,15 @@
 
 #include "copyright.h"
 #include "machine.h"
+#include "profile.h"
 #include "main.h"
 
+// The geometry of physical memory, fixed before the machine is created.
+
+int PageSize = DefaultPageSize;
+int NumPhysPages = DefaultNumPhysPages;
+int MemorySize = DefaultNumPhysPages * DefaultPageSize;
+
 // Textual names of the exceptions that can be generated by user program
 // execution, for debugging.
 static char* exceptionNames[] = { "no exception", "syscall", 
@@ -50,28 +57,58 @@ void CheckEndian()
 //
 //	"debug" -- if TRUE, drop into the debugger after each user instruction
 //		is executed.
+//	"engine" -- how to run user code: one instruction at a time, 
+//		a basic block of threaded code at a time, or the same
+//		with hot blocks compiled.
+//	"profileName" -- if not NULL, profile user programs, and write
+//		the report to this UNIX file when Nachos halts.
+//	"mapMemory" -- if TRUE, get mainMemory from the host as a fresh
+//		mapping, whose pages the host only supplies (already
+//		zeroed) when they are touched; for big memories.
 //----------------------------------------------------------------------
 
-Machine::Machine(bool debug)
+Machine::Machine(bool debug, ExecEngine engine, char *profileName, 
+							bool mapMemory)
 {
     int i;
 
     for (i = 0; i < NumTotalRegs; i++)
         registers[i] = 0;
-    mainMemory = new char[MemorySize];
-    for (i = 0; i < MemorySize; i++)
-      	mainMemory[i] = 0;
-#ifdef USE_TLB
-    tlb = new TranslationEntry[TLBSize];
-    for (i = 0; i < TLBSize; i++)
-	tlb[i].valid = FALSE;
-    pageTable = NULL;
-#else	// use linear page table
-    tlb = NULL;
+    memoryMapped = mapMemory;
+    if (memoryMapped)
+	mainMemory = AllocHostMemory(MemorySize);
+    else {
+	mainMemory = new char[MemorySize];
+	for (i = 0; i < MemorySize; i++)
+	    mainMemory[i] = 0;
+    }
+    decodeCache = new Instruction[MemorySize / 4];
+    for (i = 0; i < MemorySize / 4; i++)
+	decodeCache[i].compiled = NULL;
+    pageDecoded = new bool[NumPhysPages];
+    for (i = 0; i < NumPhysPages; i++)
+	pageDecoded[i] = FALSE;
+    readCache = new HostTranslation[HostCacheSize];
+    writeCache = new HostTranslation[HostCacheSize];
+    FlushTranslations();
+    tlb = NULL;				// use linear page table, unless
+    tlbAsid = NULL;			// the kernel enables the TLB
+    tlbSize = tlbWays = 0;
+    currentAsid = 0;
     pageTable = NULL;
-#endif
+    pageTableKind = LinearPageTable;
+    reportPageTables = FALSE;
 
     singleStep = debug;
+    profile = (profileName != NULL) ? new Profile(profileName) : NULL;
+    traceEnabled = ::debug->IsEnabled(dbgMach) || ::debug->IsEnabled(dbgAddr)
+						|| (profile != NULL);
+    execEngine = engine;
+    blockTicks = NULL;
+    icache = dcache = NULL;
+    missPenalty = 0;
+    charged.instrHits = charged.instrMisses = 0;
+    charged.dataHits = charged.dataMisses = 0;
     CheckEndian();
 }
 
@@ -82,9 +119,25 @@ Machine::Machine(bool debug)
 
 Machine::~Machine()
 {
-    delete [] mainMemory;
-    if (tlb != NULL)
+    if (memoryMapped)
+	DeallocHostMemory(mainMemory, MemorySize);
+    else
+	delete [] mainMemory;
+    for (int i = 0; i < MemorySize / 4; i++)
+	if (decodeCache[i].compiled != NULL)
+	    delete decodeCache[i].compiled;
+    delete [] decodeCache;
+    delete [] pageDecoded;
+    delete [] readCache;
+    delete [] writeCache;
+    if (profile != NULL)
+	delete profile;
+    if (tlb != NULL) {
         delete [] tlb;
+        delete [] tlbAsid;
+    }
+    delete icache;
+    delete dcache;
 }
 
 //----------------------------------------------------------------------
@@ -101,10 +154,19 @@ void
 Machine::RaiseException(ExceptionType which, int badVAddr)
 {
     DEBUG(dbgMach, "Exception: " << exceptionNames[which]);
+    if (blockTicks != NULL) {		// inside a batch: bring the
+					// clock up to date before the
+					// kernel looks at it
+	kernel->stats->totalTicks += *blockTicks * UserTick;
+	kernel->stats->userTicks += *blockTicks * UserTick;
+	*blockTicks = 0;
+	blockTicks = NULL;
+    }
     registers[BadVAddrReg] = badVAddr;
     DelayedLoad(0, 0);			// finish anything in progress
     kernel->interrupt->setStatus(SystemMode);
     ExceptionHandler(which);		// interrupts are enabled at this point
+    FlushTranslations();		// the kernel may have changed them
     kernel->interrupt->setStatus(UserMode);
 }
 
@@ -203,6 +265,144 @@ Machine::DumpState()
     cout << "\tLoadV:\t" << registers[LoadValueReg] << "\n";
 }
 
+//----------------------------------------------------------------------
+// Machine::Checkpoint, Machine::Restore
+// 	Write the user CPU registers and all of physical memory to the
+//	checkpoint file "fd", or read them back.  After a restore, the
+//	decoded instructions and cached translations are all stale; the
+//	caches being modeled (if any) start out empty.
+//----------------------------------------------------------------------
+
+void
+Machine::Checkpoint(int fd)
+{
+    WriteFile(fd, (char *) registers, sizeof(registers));
+    WriteFile(fd, mainMemory, MemorySize);
+}
+
+void
+Machine::Restore(int fd)
+{
+    Read(fd, (char *) registers, sizeof(registers));
+    Read(fd, mainMemory, MemorySize);
+    for (int i = 0; i < NumPhysPages; i++)
+	InvalidateDecodedPage(i);
+    FlushTranslations();
+    if (icache != NULL) {
+	icache->Flush();
+	dcache->Flush();
+    }
+}
+
+//----------------------------------------------------------------------
+// Machine::EnableCaches
+// 	Start modeling an instruction cache and a data cache, each of
+//	"size" bytes in lines of "lineSize" bytes, "ways" lines to a set.
+//	Every access to a line that isn't cached stalls the CPU for
+//	"penalty" ticks, charged as user time along with the instruction.
+//
+//	Compiled blocks and fused instruction pairs assume each 
+//	instruction takes exactly one tick, so with the caches on, the
+//	basic-block engine runs every instruction separately.
+//----------------------------------------------------------------------
+
+void
+Machine::EnableCaches(int size, int lineSize, int ways, int penalty)
+{
+    icache = new Cache(size, lineSize, ways);
+    dcache = new Cache(size, lineSize, ways);
+    missPenalty = penalty;
+    if (execEngine == CompileEngine)
+	execEngine = BlockEngine;
+    for (int i = 0; i < NumPhysPages; i++)
+	InvalidateDecodedPage(i);	// re-decode without pairs
+}
+
+//----------------------------------------------------------------------
+// Machine::EnableTLB
+// 	Translate user addresses through a TLB of "size" entries, split
+//	into sets of "ways" entries, all empty to start with.  From now
+//	on the kernel loads the TLB when a translation misses in it (see
+//	Translate), and must leave pageTable NULL.
+//----------------------------------------------------------------------
+
+void
+Machine::EnableTLB(int size, int ways)
+{
+    ASSERT((size > 0) && (ways > 0) && (size % ways == 0));
+    tlb = new TranslationEntry[size];
+    tlbAsid = new int[size];
+    for (int i = 0; i < size; i++) {
+	tlb[i].valid = FALSE;
+	tlbAsid[i] = -1;
+    }
+    tlbSize = size;
+    tlbWays = ways;
+    pageTable = NULL;
+    FlushTranslations();
+}
+
+//----------------------------------------------------------------------
+// Machine::UsePageTables, Machine::NewPageTable
+// 	Choose the kind of page table address spaces keep their
+//	translations in (see pagetable.h), and create them.
+//----------------------------------------------------------------------
+
+void
+Machine::UsePageTables(PageTableKind kind)
+{
+    pageTableKind = kind;
+    reportPageTables = TRUE;
+}
+
+PageTable *
+Machine::NewPageTable(int numPages)
+{
+    switch (pageTableKind) {
+      case TwoLevelPageTable:
+	return new TwoLevelTable(numPages);
+      case InvertedPageTable:
+	return new InvertedTable(numPages);
+      default:
+	return new LinearTable(numPages);
+    }
+}
+
+//----------------------------------------------------------------------
+// Machine::ChargeCaches
+// 	Add the cache hits and misses since the last call to "counts"
+//	(those of the thread that is giving up the CPU), and to the 
+//	totals in the statistics.
+//----------------------------------------------------------------------
+
+void
+Machine::ChargeCaches(CacheCounts *counts)
+{
+    Statistics *stats = kernel->stats;
+    int instrHits, instrMisses, dataHits, dataMisses;
+
+    if (icache == NULL)
+	return;
+    instrHits = icache->hits - charged.instrHits;
+    instrMisses = icache->misses - charged.instrMisses;
+    dataHits = dcache->hits - charged.dataHits;
+    dataMisses = dcache->misses - charged.dataMisses;
+
+    counts->instrHits += instrHits;
+    counts->instrMisses += instrMisses;
+    counts->dataHits += dataHits;
+    counts->dataMisses += dataMisses;
+    stats->numICacheHits += instrHits;
+    stats->numICacheMisses += instrMisses;
+    stats->numDCacheHits += dataHits;
+    stats->numDCacheMisses += dataMisses;
+
+    charged.instrHits = icache->hits;
+    charged.instrMisses = icache->misses;
+    charged.dataHits = dcache->hits;
+    charged.dataMisses = dcache->misses;
+}
+
 //----------------------------------------------------------------------
 // Machine::ReadRegister/WriteRegister
 //   	Fetch or write the contents of a user program register.
@@ -24,21 +24,46 @@
 #include "copyright.h"
 #include "utility.h"
 #include "translate.h"
+#include "pagetable.h"
+#include "cache.h"
 
-// Definitions related to the size, and format of user memory
-
-const int PageSize = 128; 		// set the page size equal to
-					// the disk sector size, for simplicity
-
-//
-// You are allowed to change this value.
-// Doing so will change the number of pages of physical memory
-// available on the simulated machine.
+// Definitions related to the size, and format of user memory.
 //
-const int NumPhysPages = 128;
-
-const int MemorySize = (NumPhysPages * PageSize);
+// The size of a page and the number of pages of physical memory are
+// chosen when Nachos boots, with "-page bytes" and "-mem pages", and
+// must not change once the machine is created (see Kernel::Kernel).
+
+const int DefaultPageSize = 128;	// the disk sector size, for
+					// simplicity
+const int DefaultNumPhysPages = 128;
+
+extern int PageSize;			// a multiple of the disk sector
+					// size, for paging to swap
+extern int NumPhysPages;
+extern int MemorySize;			// NumPhysPages * PageSize
 const int TLBSize = 4;			// if there is a TLB, make it small
+					// (the default size, with USE_TLB)
+const int NumAsids = 64;		// address-space IDs a TLB entry
+					// can be tagged with
+const int HostCacheSize = 64;		// entries in each of the caches of
+					// recent translations (a power of 2)
+
+const int MaxBatch = 10000;		// most user instructions run between
+					// checks for pending interrupts
+const int HotBlockThreshold = 50;	// times a basic block must be run
+					// before CompileEngine compiles it
+
+// The ways Machine::Run can execute user code (see mipssim.cc).  All of
+// them charge one user tick per instruction (plus any cache stalls).
+
+enum ExecEngine { InterpretEngine,	// decode and run one instruction at
+					// a time (the reference simulator)
+		  BlockEngine,		// run a basic block of threaded code
+					// at a time
+		  CompileEngine		// as BlockEngine, but blocks that run
+					// often are compiled into a 
+					// straight-line form first
+};
 
 enum ExceptionType { NoException,           // Everything ok!
 		     SyscallException,      // A program executed a system call.
@@ -56,6 +81,15 @@ enum ExceptionType { NoException,           // Everything ok!
 		     NumExceptionTypes
 };
 
+// The instruction and memory simulation routines come in two versions,
+// as templates on "bool tracing": one that prints debugging messages 
+// for the 'm' and 'a' flags and keeps the profile, and one with all of
+// that compiled out, used unless one of the flags is on, we are 
+// profiling, or we are in the debugger.
+// TRACE is DEBUG for code inside such a template.
+
+#define TRACE(flag,expr)	if (!tracing) {} else DEBUG(flag,expr)
+
 // User program CPU state.  The full set of MIPS registers, plus a few
 // more because we need to be able to start/stop a user program between
 // any two instructions (thus we need to keep track of things like load
@@ -88,12 +122,96 @@ enum ExceptionType { NoException,           // Everything ok!
 // The procedures in this class are defined in machine.cc, mipssim.cc, and
 // translate.cc.
 
-class Instruction;
 class Interrupt;
+class Machine;
+class Instruction;
+class CompiledBlock;
+class Profile;
+
+// The effect of one instruction executed by the threaded-code engine
+// (see mipssim.cc) that has to be applied once it retires: where the PC
+// goes next, and any delayed load it started.
+
+class ExecState {
+  public:
+    int pcAfter;	// new value for NextPCReg
+    int loadReg;	// register target of a delayed load (0 if none)
+    int loadValue;	// the value to be loaded
+};
+
+// A routine that executes one kind of instruction, for the threaded-code
+// engine.  Returns FALSE if the instruction raised an exception.
+
+typedef bool (*InstrHandler)(Machine *machine, Instruction *instr,
+							ExecState *state);
+
+// The following class defines an instruction, represented in both
+// 	undecoded binary form
+//      decoded to identify
+//	    operation to do
+//	    registers to act on
+//	    any immediate operand value
+
+class Instruction {
+  public:
+    void Decode();	// decode the binary representation of the instruction
+
+    unsigned int value; // binary representation of the instruction
+
+    char opCode;     // Type of instruction.  This is NOT the same as the
+    		     // opcode field from the instruction: see defs in mips.h
+    char rs, rt, rd; // Three registers from instruction.
+    int extra;       // Immediate or target or shamt field or offset.
+                     // Immediates are sign-extended.
+
+    InstrHandler handler; // Routine that executes this instruction in
+		     // the threaded-code engine
+    int blockLength; // Number of instructions from here to the end of
+		     // the basic block starting here; a block ends with
+		     // a branch, jump or trap, or at the end of the page
+    InstrHandler pair; // Routine that executes this instruction and the
+		     // next one as a single operation, if they are a
+		     // common idiom worth fusing (NULL otherwise)
+    int timesRun;    // Number of times the block starting here has run
+    CompiledBlock *compiled; // Compiled form of that block, once it
+		     // has run HotBlockThreshold times (CompileEngine only)
+};
+
+// The following classes define a compiled basic block: the handlers of
+// its instructions laid out in order, with what RunCompiled needs to
+// know about each one worked out in advance.  The branch or jump ending
+// the block, and its delay slot, are run exactly as RunBlock would; the
+// instructions before it are run without updating the PC registers,
+// except where they might trap.
+
+class CompiledOp {
+  public:
+    InstrHandler handler;	// routine that executes the instruction
+    InstrHandler pair;		// routine that executes it and the next
+				// op together, or NULL
+    Instruction *instr;		// the decoded instruction
+    bool mayTrap;		// might it raise an exception?
+    bool writesMemory;		// might it change the block's own code?
+};
+
+class CompiledBlock {
+  public:
+    CompiledBlock(int len) { length = len; ops = new CompiledOp[len]; }
+    ~CompiledBlock() { delete [] ops; }
+
+    int length;			// number of instructions in the block,
+				// including any branch delay slot
+    int straight;		// number of them before the branch/jump
+				// (and before a compare fused with it)
+    int pageFrame;		// physical page holding the block
+    CompiledOp *ops;
+};
 
 class Machine {
   public:
-    Machine(bool debug);	// Initialize the simulation of the hardware
+    Machine(bool debug, ExecEngine engine, char *profileName, 
+							bool mapMemory);
+				// Initialize the simulation of the hardware
 				// for running user programs
     ~Machine();			// De-allocate the data structures
 
@@ -105,6 +223,12 @@ class Machine {
     void WriteRegister(int num, int value);
 				// store a value into a CPU register
 
+    void AdvancePC() {		// step past the instruction that trapped,
+	registers[PrevPCReg] = registers[PCReg];	// e.g. a syscall
+	registers[PCReg] += 4;
+	registers[NextPCReg] = registers[PCReg] + 4;
+    }
+
 // Data structures accessible to the Nachos kernel -- main memory and the
 // page table/TLB.
 //
@@ -131,29 +255,119 @@ class Machine {
 // space, stored in memory), there is only one TLB (implemented in hardware).
 // Thus the TLB pointer should be considered as *read-only*, although 
 // the contents of the TLB are free to be modified by the kernel software.
+//
+// The TLB is set-associative: virtual page "vpn" can only be held by
+// one of the "tlbWays" entries starting at TLBSet(vpn).  Each entry is
+// tagged with the ID of the address space it belongs to, in tlbAsid,
+// and only matches while "currentAsid" is that ID, so the kernel need
+// not empty the TLB on a context switch.
 
     TranslationEntry *tlb;		// this pointer should be considered 
 					// "read-only" to Nachos kernel code
-
-    TranslationEntry *pageTable;
-    unsigned int pageTableSize;
+    int *tlbAsid;			// the address-space ID of each entry
+    int tlbSize;			// entries in the TLB (0 if none)
+    int tlbWays;			// entries in each set
+    int currentAsid;			// the running address space's ID
+
+    void EnableTLB(int size, int ways);
+				// Translate through a TLB of "size"
+				// entries, "ways" to a set, instead of
+				// a page table
+    int TLBSet(int vpn) { return (vpn % (tlbSize / tlbWays)) * tlbWays; }
+				// The first TLB entry that may hold "vpn"
+
+    PageTable *pageTable;		// the running address space's page
+					// table, if there is no TLB
+
+    void UsePageTables(PageTableKind kind);
+				// Keep translations in page tables of this
+				// kind, rather than linear ones, and report
+				// how much memory each process's takes
+    PageTable *NewPageTable(int numPages);
+				// Create an empty page table of that kind,
+				// for an address space of "numPages" pages
+    bool ReportsPageTables() { return reportPageTables; }
+
+    Profile *profile;		// counts of the user instructions executed,
+				// or NULL if we are not profiling; the
+				// kernel adds the symbols of the programs
+				// it loads
 
     bool ReadMem(int addr, int size, int* value);
     bool WriteMem(int addr, int size, int value);
     				// Read or write 1, 2, or 4 bytes of virtual 
 				// memory (at addr).  Return FALSE if a 
 				// correct translation couldn't be found.
+
+    template <bool tracing> bool ReadMemory(int addr, int size, int* value);
+    template <bool tracing> bool WriteMemory(int addr, int size, int value);
+				// ReadMem and WriteMem, with or without
+				// the debugging messages compiled in
+
+    void FlushTranslations();	// Forget all cached translations.  The
+				// kernel must call this whenever it 
+				// changes pageTable or tlb, or the entries
+				// in them (including clearing a use or
+				// dirty bit), other than while handling
+				// an exception.
+
+    void InvalidateDecodedPage(int pageFrame);
+				// Throw away the decoded instructions
+				// cached for physical page "pageFrame".
+				// The kernel must call this whenever it
+				// changes mainMemory directly (e.g., when
+				// loading a program or reading a file into
+				// a user buffer) rather than via WriteMem.
+
+    void Checkpoint(int fd);	// save the registers and mainMemory to
+    void Restore(int fd);	// the UNIX file "fd", or read them back
+
+    void EnableCaches(int size, int lineSize, int ways, int penalty);
+				// Model an I-cache and a D-cache of this
+				// shape; each miss costs "penalty" ticks
+    void ChargeCaches(CacheCounts *counts);
+				// Add the cache hits and misses since the
+				// last call to "counts", and to the totals
+				// in the statistics
+    bool ModelsCaches() { return icache != NULL; }
   private:
 
 // Routines internal to the machine simulation -- DO NOT call these directly
     void DelayedLoad(int nextReg, int nextVal);  	
 				// Do a pending delayed load (modifying a reg)
 
-    void OneInstruction(Instruction *instr); 	
-    				// Run one instruction of a user program.
+    template <bool tracing> bool OneInstruction();
+				// Run one instruction of a user program.
+				// Return FALSE if it trapped.
+
+    template <bool tracing> void RunBatch();
+				// Run user instructions until the next
+				// pending interrupt is due
+
+    bool RunBlock(int limit);	// Run the basic block at the PC (at most
+				// "limit" instructions of it), using the
+				// threaded-code engine.  Return FALSE if
+				// it trapped.
+
+    CompiledBlock *CompileBlock(Instruction *first);
+				// Compile the basic block starting at 
+				// "first", once it has been found to be hot
+    bool RunCompiled(CompiledBlock *block);
+				// Run a compiled block, starting at the PC.
+				// Return FALSE if it trapped.
+
+    template <bool tracing> Instruction *FetchInstruction();
+				// Translate the PC, and return the decoded
+				// instruction it points to, or NULL if
+				// the fetch raised an exception
+
+    void DecodePage(int pageFrame);
+				// Decode every word of physical page
+				// "pageFrame" into the decode cache
     
 
 
+    template <bool tracing>
     ExceptionType Translate(int virtAddr, int* physAddr, int size,bool writing);
     				// Translate an address, and check for 
 				// alignment.  Set the use and dirty bits in 
@@ -161,6 +375,19 @@ class Machine {
     				// and return an exception code if the 
 				// translation couldn't be completed.
 
+    void CacheTranslation(HostTranslation *cached, unsigned int vpn,
+							int pageFrame);
+				// Remember a translation that just 
+				// succeeded, in readCache or writeCache
+
+    void CacheAccess(Cache *cache, int physAddr) {
+				// Model an access to "physAddr" through
+				// "cache", stalling the running batch on
+				// a miss
+	if (!cache->Access(physAddr) && (blockTicks != NULL))
+	    *blockTicks += missPenalty;
+    }
+
     void RaiseException(ExceptionType which, int badVAddr);
 				// Trap to the Nachos kernel, because of a
 				// system call or other exception.  
@@ -173,18 +400,56 @@ class Machine {
 
     int registers[NumTotalRegs]; // CPU registers, for executing user programs
 
+    HostTranslation *readCache;	// recent translations that are valid for
+				// reading, indexed by virtual page #
+    HostTranslation *writeCache; // recent translations that are valid for
+				// writing -- and whose dirty bit is 
+				// already set
+
+    bool memoryMapped;		// is mainMemory a host mapping (from
+				// AllocHostMemory), rather than new[]?
+    Instruction *decodeCache;	// decoded form of every word of mainMemory,
+				// indexed by physical word address
+    bool *pageDecoded;		// is a physical page's part of decodeCache
+				// up to date?  Cleared on any write to
+				// the page, so it is re-decoded on the
+				// next fetch
+
     bool singleStep;		// drop back into the debugger after each
 				// simulated instruction
+    bool traceEnabled;		// is the 'm' or 'a' debugging flag on, or
+				// are we profiling?
     int runUntilTime;		// drop back into the debugger when simulated
 				// time reaches this value
 
+    ExecEngine execEngine;	// how to run user code
+    int *blockTicks;		// instructions retired by the running batch
+				// (and cache stalls) but not yet added to
+				// the simulated time; charged by
+				// RaiseException before trapping
+
+    Cache *icache;		// the caches being modeled, or NULL if
+    Cache *dcache;		// we aren't modeling them
+    int missPenalty;		// ticks the CPU stalls for on a miss
+    CacheCounts charged;	// hits and misses already handed out by
+				// ChargeCaches
+
+    PageTableKind pageTableKind; // how page tables are laid out
+    bool reportPageTables;	// was the kind chosen with -pt?
+
     friend class Interrupt;		// calls DelayedLoad()    
+    friend class ThreadedCode;		// the threaded-code instruction
+					// handlers, in mipssim.cc
 };
 
 extern void ExceptionHandler(ExceptionType which);
 				// Entry point into Nachos for handling
 				// user system calls and exceptions
 				// Defined in exception.cc
+extern const char *SyscallName(int code);
+				// The name of system call "code" (NULL
+				// if it isn't one), for Statistics;
+				// also in exception.cc
 
 
 // Routines for converting Words and Short Words to and from the
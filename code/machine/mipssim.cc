@@ -20,30 +20,11 @@
 #include "debug.h"
 #include "machine.h"
 #include "mipssim.h"
+#include "profile.h"
 #include "main.h"
 
 static void Mult(int a, int b, bool signedArith, int* hiPtr, int* loPtr);
 
-// The following class defines an instruction, represented in both
-// 	undecoded binary form
-//      decoded to identify
-//	    operation to do
-//	    registers to act on
-//	    any immediate operand value
-
-class Instruction {
-  public:
-    void Decode();	// decode the binary representation of the instruction
-
-    unsigned int value; // binary representation of the instruction
-
-    char opCode;     // Type of instruction.  This is NOT the same as the
-    		     // opcode field from the instruction: see defs in mips.h
-    char rs, rt, rd; // Three registers from instruction.
-    int extra;       // Immediate or target or shamt field or offset.
-                     // Immediates are sign-extended.
-};
-
 //----------------------------------------------------------------------
 // Machine::Run
 // 	Simulate the execution of a user-level program on Nachos.
@@ -51,26 +32,91 @@ class Instruction {
 //
 //	This routine is re-entrant, in that it can be called multiple
 //	times concurrently -- one for each thread executing user code.
+//
+//	Unless we are single-stepping in the debugger, instructions are
+//	run in batches that end just as the next pending interrupt falls
+//	due (see RunBatch), rather than checking for interrupts after 
+//	every instruction.  Which version of the simulator to use -- with
+//	debugging messages compiled in or not -- is decided once per 
+//	batch, or per instruction in the debugger, rather than on every
+//	instruction and memory access.
 //----------------------------------------------------------------------
 
 void
 Machine::Run()
 {
-    Instruction *instr = new Instruction;  // storage for decoded instruction
-
     if (debug->IsEnabled('m')) {
         cout << "Starting program in thread: " << kernel->currentThread->getName();
 		cout << ", at time: " << kernel->stats->totalTicks << "\n";
     }
     kernel->interrupt->setStatus(UserMode);
     for (;;) {
-        OneInstruction(instr);
-		kernel->interrupt->OneTick();
-		if (singleStep && (runUntilTime <= kernel->stats->totalTicks))
-	  		Debugger();
+	if (singleStep) {
+	    int stalls = 0;		// cache stalls, if we model them
+
+	    blockTicks = &stalls;
+	    OneInstruction<TRUE>();
+	    blockTicks = NULL;
+	    kernel->interrupt->AdvanceTicks(1 + stalls);
+	    if (runUntilTime <= kernel->stats->totalTicks)
+		Debugger();
+	} else if (traceEnabled)
+	    RunBatch<TRUE>();
+	else
+	    RunBatch<FALSE>();
     }
 }
 
+//----------------------------------------------------------------------
+// Machine::RunBatch
+// 	Run user instructions up to the time the next pending interrupt
+//	is due, then advance simulated time by the number executed (which
+//	takes the interrupt).
+//
+//	Between two interrupts, the OneTick after each instruction would
+//	only advance the clock, so leaving it out doesn't change the
+//	timeline: every interrupt still happens after the same instruction
+//	it would have with the reference loop in Run.  The one exception
+//	is a trap -- the kernel can schedule interrupts, or switch 
+//	threads -- so a trap ends the batch; before trapping, 
+//	RaiseException brings the clock up to date for the instructions
+//	that did retire.
+//
+//	Unless we are tracing, the basic-block engines (if selected) run 
+//	the batch a block at a time, with no block running past its end.
+//
+//	Cache stalls (see EnableCaches) are counted in "retired" along
+//	with the instructions, so they use up the batch too, and every 
+//	engine still takes each interrupt after the same instruction.
+//----------------------------------------------------------------------
+
+template <bool tracing> void
+Machine::RunBatch()
+{
+    int due = kernel->interrupt->NextDue();
+    int budget = MaxBatch;		// instructions we may run
+    int retired = 0;			// executed, but not yet charged for
+    bool trapped = FALSE;
+
+    if ((due >= 0) && (due - kernel->stats->totalTicks < budget))
+	budget = due - kernel->stats->totalTicks;
+    if (budget < 1)
+	budget = 1;
+
+    blockTicks = &retired;
+    while (!trapped && (retired < budget)) {
+	if (!tracing && (execEngine != InterpretEngine))
+	    trapped = !RunBlock(budget - retired);
+	else if (OneInstruction<tracing>())
+	    retired++;
+	else
+	    trapped = TRUE;
+    }
+    blockTicks = NULL;
+    if (trapped)
+	retired++;			// the instruction that trapped
+    kernel->interrupt->AdvanceTicks(retired);
+}
 
 //----------------------------------------------------------------------
 // TypeToReg
@@ -115,27 +161,32 @@ TypeToReg(RegType reg, Instruction *instr)
 //	leaving.  This allows the Nachos kernel to control our behavior
 //	by controlling the contents of memory, the translation table,
 //	and the register set.
+//
+//	"tracing" -- if FALSE, the 'm' and 'a' debugging messages, and
+//		profiling, are compiled out.
 //----------------------------------------------------------------------
 
-void
-Machine::OneInstruction(Instruction *instr)
+template <bool tracing> bool
+Machine::OneInstruction()
 {
 #ifdef SIM_FIX
     int byte;       // described in Kane for LWL,LWR,...
 #endif
 
-    int raw;
+    Instruction *instr;
     int nextLoadReg = 0; 	
     int nextLoadValue = 0; 	// record delayed load operation, to apply
 				// in the future
 
     // Fetch instruction 
-    if (!ReadMem(registers[PCReg], 4, &raw))
-	return;			// exception occurred
-    instr->value = raw;
-    instr->Decode();
+    if ((instr = FetchInstruction<tracing>()) == NULL)
+	return FALSE;		// exception occurred
+    if (icache != NULL)
+	CacheAccess(icache, (instr - decodeCache) * 4);
 
-    if (debug->IsEnabled('m')) {
+    if (tracing && (profile != NULL))
+	profile->CountInstruction(registers[PCReg]);
+    if (tracing && debug->IsEnabled('m')) {
         struct OpString *str = &opStrings[instr->opCode];
 	char buf[80];
 
@@ -159,7 +210,7 @@ Machine::OneInstruction(Instruction *instr)
 	if (!((registers[instr->rs] ^ registers[instr->rt]) & SIGN_BIT) &&
 	    ((registers[instr->rs] ^ sum) & SIGN_BIT)) {
 	    RaiseException(OverflowException, 0);
-	    return;
+	    return FALSE;
 	}
 	registers[instr->rd] = sum;
 	break;
@@ -169,7 +220,7 @@ Machine::OneInstruction(Instruction *instr)
 	if (!((registers[instr->rs] ^ instr->extra) & SIGN_BIT) &&
 	    ((instr->extra ^ sum) & SIGN_BIT)) {
 	    RaiseException(OverflowException, 0);
-	    return;
+	    return FALSE;
 	}
 	registers[instr->rt] = sum;
 	break;
@@ -263,8 +314,8 @@ Machine::OneInstruction(Instruction *instr)
       case OP_LB:
       case OP_LBU:
 	tmp = registers[instr->rs] + instr->extra;
-	if (!ReadMem(tmp, 1, &value))
-	    return;
+	if (!ReadMemory<tracing>(tmp, 1, &value))
+	    return FALSE;
 
 	if ((value & 0x80) && (instr->opCode == OP_LB))
 	    value |= 0xffffff00;
@@ -279,10 +330,10 @@ Machine::OneInstruction(Instruction *instr)
 	tmp = registers[instr->rs] + instr->extra;
 	if (tmp & 0x1) {
 	    RaiseException(AddressErrorException, tmp);
-	    return;
+	    return FALSE;
 	}
-	if (!ReadMem(tmp, 2, &value))
-	    return;
+	if (!ReadMemory<tracing>(tmp, 2, &value))
+	    return FALSE;
 
 	if ((value & 0x8000) && (instr->opCode == OP_LH))
 	    value |= 0xffff0000;
@@ -301,10 +352,10 @@ Machine::OneInstruction(Instruction *instr)
 	tmp = registers[instr->rs] + instr->extra;
 	if (tmp & 0x3) {
 	    RaiseException(AddressErrorException, tmp);
-	    return;
+	    return FALSE;
 	}
-	if (!ReadMem(tmp, 4, &value))
-	    return;
+	if (!ReadMemory<tracing>(tmp, 4, &value))
+	    return FALSE;
 	nextLoadReg = instr->rt;
 	nextLoadValue = value;
 	break;
@@ -323,16 +374,16 @@ Machine::OneInstruction(Instruction *instr)
         byte = tmp & 0x3;
         // DEBUG('P', "Addr 0x%X\n",tmp-byte);
 
-        if (!ReadMem(tmp-byte, 4, &value))
-            return;
+        if (!ReadMemory<tracing>(tmp-byte, 4, &value))
+            return FALSE;
 #else
 	// ReadMem assumes all 4 byte requests are aligned on an even 
 	// word boundary.  Also, the little endian/big endian swap code would
         // fail (I think) if the other cases are ever exercised.
 	ASSERT((tmp & 0x3) == 0);  
 
-	if (!ReadMem(tmp, 4, &value))
-	    return;
+	if (!ReadMemory<tracing>(tmp, 4, &value))
+	    return FALSE;
 #endif
 
 	if (registers[LoadReg] == instr->rt)
@@ -375,16 +426,16 @@ Machine::OneInstruction(Instruction *instr)
         byte = tmp & 0x3;
         // DEBUG('P', "Addr 0x%X\n",tmp-byte);
 
-        if (!ReadMem(tmp-byte, 4, &value))
-            return;
+        if (!ReadMemory<tracing>(tmp-byte, 4, &value))
+            return FALSE;
 #else
 	// ReadMem assumes all 4 byte requests are aligned on an even 
 	// word boundary.  Also, the little endian/big endian swap code would
         // fail (I think) if the other cases are ever exercised.
 	ASSERT((tmp & 0x3) == 0);  
 
-	if (!ReadMem(tmp, 4, &value))
-	    return;
+	if (!ReadMemory<tracing>(tmp, 4, &value))
+	    return FALSE;
 #endif
 
 	if (registers[LoadReg] == instr->rt)
@@ -456,15 +507,15 @@ Machine::OneInstruction(Instruction *instr)
 	break;
 	
       case OP_SB:
-	if (!WriteMem((unsigned) 
+	if (!WriteMemory<tracing>((unsigned) 
 		(registers[instr->rs] + instr->extra), 1, registers[instr->rt]))
-	    return;
+	    return FALSE;
 	break;
 	
       case OP_SH:
-	if (!WriteMem((unsigned) 
+	if (!WriteMemory<tracing>((unsigned) 
 		(registers[instr->rs] + instr->extra), 2, registers[instr->rt]))
-	    return;
+	    return FALSE;
 	break;
 	
       case OP_SLL:
@@ -534,7 +585,7 @@ Machine::OneInstruction(Instruction *instr)
 	if (((registers[instr->rs] ^ registers[instr->rt]) & SIGN_BIT) &&
 	    ((registers[instr->rs] ^ diff) & SIGN_BIT)) {
 	    RaiseException(OverflowException, 0);
-	    return;
+	    return FALSE;
 	}
 	registers[instr->rd] = diff;
 	break;
@@ -544,9 +595,9 @@ Machine::OneInstruction(Instruction *instr)
 	break;
 	
       case OP_SW:
-	if (!WriteMem((unsigned) 
+	if (!WriteMemory<tracing>((unsigned) 
 		(registers[instr->rs] + instr->extra), 4, registers[instr->rt]))
-	    return;
+	    return FALSE;
 	break;
 	
       case OP_SWL:	  
@@ -561,8 +612,8 @@ Machine::OneInstruction(Instruction *instr)
 
         byte = tmp & 0x3;
         // DEBUG('P', "Addr 0x%X\n",tmp-byte);
-        if (!ReadMem(tmp-byte, 4, &value))
-            return;
+        if (!ReadMemory<tracing>(tmp-byte, 4, &value))
+            return FALSE;
 
         // DEBUG('P', "Value 0x%X\n",value);
 #else
@@ -571,8 +622,8 @@ Machine::OneInstruction(Instruction *instr)
         // fail (I think) if the other cases are ever exercised.
 	ASSERT((tmp & 0x3) == 0);  
 
-	if (!ReadMem((tmp & ~0x3), 4, &value))
-	    return;
+	if (!ReadMemory<tracing>((tmp & ~0x3), 4, &value))
+	    return FALSE;
 #endif
 
 #ifdef SIM_FIX
@@ -598,13 +649,13 @@ Machine::OneInstruction(Instruction *instr)
 	    break;
 	}
 #ifndef SIM_FIX
-        if (!WriteMem((tmp & ~0x3), 4, value))
-            return;
+        if (!WriteMemory<tracing>((tmp & ~0x3), 4, value))
+            return FALSE;
 #else
         // DEBUG('P', "Value 0x%X\n",value);
 
-        if (!WriteMem((tmp - byte), 4, value))
-            return;
+        if (!WriteMemory<tracing>((tmp - byte), 4, value))
+            return FALSE;
 #endif // SIM_FIX
 	break;
     	
@@ -616,8 +667,8 @@ Machine::OneInstruction(Instruction *instr)
         // fail (I think) if the other cases are ever exercised.
         ASSERT((tmp & 0x3) == 0);  
 
-        if (!ReadMem((tmp & ~0x3), 4, &value))
-            return;
+        if (!ReadMemory<tracing>((tmp & ~0x3), 4, &value))
+            return FALSE;
 #else
         // The only difference between this code and the BIG ENDIAN code
         // is that the ReadMem call is guaranteed an aligned access as 
@@ -629,8 +680,8 @@ Machine::OneInstruction(Instruction *instr)
         byte = tmp & 0x3;
         // DEBUG('P', "Addr 0x%X\n",tmp-byte);
 
-        if (!ReadMem(tmp-byte, 4, &value))
-            return;
+        if (!ReadMemory<tracing>(tmp-byte, 4, &value))
+            return FALSE;
         // DEBUG('P', "Value 0x%X\n",value);
 #endif // SIM_FIX
 
@@ -655,13 +706,13 @@ Machine::OneInstruction(Instruction *instr)
 	}
 
 #ifndef SIM_FIX
-        if (!WriteMem((tmp & ~0x3), 4, value))
-            return;
+        if (!WriteMemory<tracing>((tmp & ~0x3), 4, value))
+            return FALSE;
 #else
         // DEBUG('P', "Value 0x%X\n",value);
 
-        if (!WriteMem((tmp - byte), 4, value))
-            return;
+        if (!WriteMemory<tracing>((tmp - byte), 4, value))
+            return FALSE;
 #endif // SIM_FIX
 
 
@@ -669,7 +720,7 @@ Machine::OneInstruction(Instruction *instr)
     	
       case OP_SYSCALL:
 	RaiseException(SyscallException, 0);
-	return; 
+	return FALSE; 
 	
       case OP_XOR:
 	registers[instr->rd] = registers[instr->rs] ^ registers[instr->rt];
@@ -682,7 +733,7 @@ Machine::OneInstruction(Instruction *instr)
       case OP_RES:
       case OP_UNIMP:
 	RaiseException(IllegalInstrException, 0);
-	return;
+	return FALSE;
 	
       default:
 	ASSERT(FALSE);
@@ -690,6 +741,9 @@ Machine::OneInstruction(Instruction *instr)
     
     // Now we have successfully executed the instruction.
     
+    if (tracing && (profile != NULL) && (pcAfter != registers[NextPCReg] + 4))
+	profile->CountBranch(pcAfter);	// a branch or jump was taken
+
     // Do any delayed load operation
     DelayedLoad(nextLoadReg, nextLoadValue);
     
@@ -698,6 +752,1027 @@ Machine::OneInstruction(Instruction *instr)
 						// are jumping into lala-land
     registers[PCReg] = registers[NextPCReg];
     registers[NextPCReg] = pcAfter;
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// ThreadedCode
+// 	The instruction handlers for the basic-block engine.
+//
+//	Rather than switching on the opcode every time an instruction is
+//	executed, DecodePage looks up the handler for each instruction once,
+//	and stores a pointer to it in the decoded instruction; RunBlock then
+//	just calls through that pointer ("direct-threaded code").
+//
+//	Each handler does exactly what the corresponding case in
+//	OneInstruction does, except that the delayed load and the new PC 
+//	are returned in "state", to be applied by RunBlock when the
+//	instruction retires.  A handler returns FALSE if the instruction
+//	raised an exception, in which case "state" is ignored.
+//----------------------------------------------------------------------
+
+class ThreadedCode {
+  public:
+    static InstrHandler HandlerFor(int opCode);
+    static InstrHandler PairFor(Instruction *first, Instruction *second);
+    static bool EndsBlock(int opCode);
+    static bool IsBranch(int opCode);
+    static bool MayTrap(int opCode);
+    static bool WritesMemory(int opCode);
+
+    static bool Add(Machine *m, Instruction *instr, ExecState *s) {
+	int *r = m->registers;
+	int sum = r[instr->rs] + r[instr->rt];
+	if (!((r[instr->rs] ^ r[instr->rt]) & SIGN_BIT) &&
+	    ((r[instr->rs] ^ sum) & SIGN_BIT)) {
+	    m->RaiseException(OverflowException, 0);
+	    return FALSE;
+	}
+	r[instr->rd] = sum;
+	return TRUE;
+    }
+    static bool Addi(Machine *m, Instruction *instr, ExecState *s) {
+	int *r = m->registers;
+	int sum = r[instr->rs] + instr->extra;
+	if (!((r[instr->rs] ^ instr->extra) & SIGN_BIT) &&
+	    ((instr->extra ^ sum) & SIGN_BIT)) {
+	    m->RaiseException(OverflowException, 0);
+	    return FALSE;
+	}
+	r[instr->rt] = sum;
+	return TRUE;
+    }
+    static bool Addiu(Machine *m, Instruction *instr, ExecState *s) {
+	m->registers[instr->rt] = m->registers[instr->rs] + instr->extra;
+	return TRUE;
+    }
+    static bool Addu(Machine *m, Instruction *instr, ExecState *s) {
+	int *r = m->registers;
+	r[instr->rd] = r[instr->rs] + r[instr->rt];
+	return TRUE;
+    }
+    static bool And(Machine *m, Instruction *instr, ExecState *s) {
+	int *r = m->registers;
+	r[instr->rd] = r[instr->rs] & r[instr->rt];
+	return TRUE;
+    }
+    static bool Andi(Machine *m, Instruction *instr, ExecState *s) {
+	m->registers[instr->rt] = 
+		m->registers[instr->rs] & (instr->extra & 0xffff);
+	return TRUE;
+    }
+    static bool Beq(Machine *m, Instruction *instr, ExecState *s) {
+	int *r = m->registers;
+	if (r[instr->rs] == r[instr->rt])
+	    s->pcAfter = r[NextPCReg] + IndexToAddr(instr->extra);
+	return TRUE;
+    }
+    static bool Bgez(Machine *m, Instruction *instr, ExecState *s) {
+	int *r = m->registers;
+	if (!(r[instr->rs] & SIGN_BIT))
+	    s->pcAfter = r[NextPCReg] + IndexToAddr(instr->extra);
+	return TRUE;
+    }
+    static bool Bgezal(Machine *m, Instruction *instr, ExecState *s) {
+	m->registers[R31] = m->registers[NextPCReg] + 4;
+	return Bgez(m, instr, s);
+    }
+    static bool Bgtz(Machine *m, Instruction *instr, ExecState *s) {
+	int *r = m->registers;
+	if (r[instr->rs] > 0)
+	    s->pcAfter = r[NextPCReg] + IndexToAddr(instr->extra);
+	return TRUE;
+    }
+    static bool Blez(Machine *m, Instruction *instr, ExecState *s) {
+	int *r = m->registers;
+	if (r[instr->rs] <= 0)
+	    s->pcAfter = r[NextPCReg] + IndexToAddr(instr->extra);
+	return TRUE;
+    }
+    static bool Bltz(Machine *m, Instruction *instr, ExecState *s) {
+	int *r = m->registers;
+	if (r[instr->rs] & SIGN_BIT)
+	    s->pcAfter = r[NextPCReg] + IndexToAddr(instr->extra);
+	return TRUE;
+    }
+    static bool Bltzal(Machine *m, Instruction *instr, ExecState *s) {
+	m->registers[R31] = m->registers[NextPCReg] + 4;
+	return Bltz(m, instr, s);
+    }
+    static bool Bne(Machine *m, Instruction *instr, ExecState *s) {
+	int *r = m->registers;
+	if (r[instr->rs] != r[instr->rt])
+	    s->pcAfter = r[NextPCReg] + IndexToAddr(instr->extra);
+	return TRUE;
+    }
+    static bool Div(Machine *m, Instruction *instr, ExecState *s) {
+	int *r = m->registers;
+	if (r[instr->rt] == 0) {
+	    r[LoReg] = 0;
+	    r[HiReg] = 0;
+	} else {
+	    r[LoReg] = r[instr->rs] / r[instr->rt];
+	    r[HiReg] = r[instr->rs] % r[instr->rt];
+	}
+	return TRUE;
+    }
+    static bool Divu(Machine *m, Instruction *instr, ExecState *s) {
+	int *r = m->registers;
+	unsigned int rs = (unsigned int) r[instr->rs];
+	unsigned int rt = (unsigned int) r[instr->rt];
+	if (rt == 0) {
+	    r[LoReg] = 0;
+	    r[HiReg] = 0;
+	} else {
+	    r[LoReg] = (int) (rs / rt);
+	    r[HiReg] = (int) (rs % rt);
+	}
+	return TRUE;
+    }
+    static bool J(Machine *m, Instruction *instr, ExecState *s) {
+	s->pcAfter = (s->pcAfter & 0xf0000000) | IndexToAddr(instr->extra);
+	return TRUE;
+    }
+    static bool Jal(Machine *m, Instruction *instr, ExecState *s) {
+	m->registers[R31] = m->registers[NextPCReg] + 4;
+	return J(m, instr, s);
+    }
+    static bool Jalr(Machine *m, Instruction *instr, ExecState *s) {
+	m->registers[instr->rd] = m->registers[NextPCReg] + 4;
+	return Jr(m, instr, s);
+    }
+    static bool Jr(Machine *m, Instruction *instr, ExecState *s) {
+	s->pcAfter = m->registers[instr->rs];
+	return TRUE;
+    }
+    static bool Lb(Machine *m, Instruction *instr, ExecState *s) {
+	int value;
+	if (!m->ReadMemory<FALSE>(m->registers[instr->rs] + instr->extra, 1, &value))
+	    return FALSE;
+	if ((value & 0x80) && (instr->opCode == OP_LB))
+	    value |= 0xffffff00;
+	else
+	    value &= 0xff;
+	s->loadReg = instr->rt;
+	s->loadValue = value;
+	return TRUE;
+    }
+    static bool Lh(Machine *m, Instruction *instr, ExecState *s) {
+	int value;
+	int addr = m->registers[instr->rs] + instr->extra;
+	if (addr & 0x1) {
+	    m->RaiseException(AddressErrorException, addr);
+	    return FALSE;
+	}
+	if (!m->ReadMemory<FALSE>(addr, 2, &value))
+	    return FALSE;
+	if ((value & 0x8000) && (instr->opCode == OP_LH))
+	    value |= 0xffff0000;
+	else
+	    value &= 0xffff;
+	s->loadReg = instr->rt;
+	s->loadValue = value;
+	return TRUE;
+    }
+    static bool Lui(Machine *m, Instruction *instr, ExecState *s) {
+	m->registers[instr->rt] = instr->extra << 16;
+	return TRUE;
+    }
+    static bool Lw(Machine *m, Instruction *instr, ExecState *s) {
+	int value;
+	int addr = m->registers[instr->rs] + instr->extra;
+	if (addr & 0x3) {
+	    m->RaiseException(AddressErrorException, addr);
+	    return FALSE;
+	}
+	if (!m->ReadMemory<FALSE>(addr, 4, &value))
+	    return FALSE;
+	s->loadReg = instr->rt;
+	s->loadValue = value;
+	return TRUE;
+    }
+    static bool Lwl(Machine *m, Instruction *instr, ExecState *s) {
+	int *r = m->registers;
+	int value, old;
+	int addr = r[instr->rs] + instr->extra;
+#ifdef SIM_FIX
+	int byte = addr & 0x3;
+	if (!m->ReadMemory<FALSE>(addr - byte, 4, &value))
+	    return FALSE;
+	int which = 3 - byte;
+#else
+	ASSERT((addr & 0x3) == 0);  
+	if (!m->ReadMemory<FALSE>(addr, 4, &value))
+	    return FALSE;
+	int which = addr & 0x3;
+#endif
+	old = (r[LoadReg] == instr->rt) ? r[LoadValueReg] : r[instr->rt];
+	switch (which) {
+	  case 0: old = value; break;
+	  case 1: old = (old & 0xff) | (value << 8); break;
+	  case 2: old = (old & 0xffff) | (value << 16); break;
+	  case 3: old = (old & 0xffffff) | (value << 24); break;
+	}
+	s->loadReg = instr->rt;
+	s->loadValue = old;
+	return TRUE;
+    }
+    static bool Lwr(Machine *m, Instruction *instr, ExecState *s) {
+	int *r = m->registers;
+	int value, old;
+	int addr = r[instr->rs] + instr->extra;
+#ifdef SIM_FIX
+	int byte = addr & 0x3;
+	if (!m->ReadMemory<FALSE>(addr - byte, 4, &value))
+	    return FALSE;
+	int which = 3 - byte;
+#else
+	ASSERT((addr & 0x3) == 0);  
+	if (!m->ReadMemory<FALSE>(addr, 4, &value))
+	    return FALSE;
+	int which = addr & 0x3;
+#endif
+	old = (r[LoadReg] == instr->rt) ? r[LoadValueReg] : r[instr->rt];
+	switch (which) {
+	  case 0: old = (old & 0xffffff00) | ((value >> 24) & 0xff); break;
+	  case 1: old = (old & 0xffff0000) | ((value >> 16) & 0xffff); break;
+	  case 2: old = (old & 0xff000000) | ((value >> 8) & 0xffffff); break;
+	  case 3: old = value; break;
+	}
+	s->loadReg = instr->rt;
+	s->loadValue = old;
+	return TRUE;
+    }
+    static bool Mfhi(Machine *m, Instruction *instr, ExecState *s) {
+	m->registers[instr->rd] = m->registers[HiReg];
+	return TRUE;
+    }
+    static bool Mflo(Machine *m, Instruction *instr, ExecState *s) {
+	m->registers[instr->rd] = m->registers[LoReg];
+	return TRUE;
+    }
+    static bool Mthi(Machine *m, Instruction *instr, ExecState *s) {
+	m->registers[HiReg] = m->registers[instr->rs];
+	return TRUE;
+    }
+    static bool Mtlo(Machine *m, Instruction *instr, ExecState *s) {
+	m->registers[LoReg] = m->registers[instr->rs];
+	return TRUE;
+    }
+    static bool Multiply(Machine *m, Instruction *instr, ExecState *s) {
+	int *r = m->registers;
+	Mult(r[instr->rs], r[instr->rt], TRUE, &r[HiReg], &r[LoReg]);
+	return TRUE;
+    }
+    static bool MultiplyU(Machine *m, Instruction *instr, ExecState *s) {
+	int *r = m->registers;
+	Mult(r[instr->rs], r[instr->rt], FALSE, &r[HiReg], &r[LoReg]);
+	return TRUE;
+    }
+    static bool Nor(Machine *m, Instruction *instr, ExecState *s) {
+	int *r = m->registers;
+	r[instr->rd] = ~(r[instr->rs] | r[instr->rt]);
+	return TRUE;
+    }
+    static bool Or(Machine *m, Instruction *instr, ExecState *s) {
+	int *r = m->registers;
+	r[instr->rd] = r[instr->rs] | r[instr->rt];
+	return TRUE;
+    }
+    static bool Ori(Machine *m, Instruction *instr, ExecState *s) {
+	m->registers[instr->rt] = 
+		m->registers[instr->rs] | (instr->extra & 0xffff);
+	return TRUE;
+    }
+    static bool Sb(Machine *m, Instruction *instr, ExecState *s) {
+	int *r = m->registers;
+	return m->WriteMemory<FALSE>((unsigned) (r[instr->rs] + instr->extra), 1, 
+							r[instr->rt]);
+    }
+    static bool Sh(Machine *m, Instruction *instr, ExecState *s) {
+	int *r = m->registers;
+	return m->WriteMemory<FALSE>((unsigned) (r[instr->rs] + instr->extra), 2, 
+							r[instr->rt]);
+    }
+    static bool Sll(Machine *m, Instruction *instr, ExecState *s) {
+	m->registers[instr->rd] = m->registers[instr->rt] << instr->extra;
+	return TRUE;
+    }
+    static bool Sllv(Machine *m, Instruction *instr, ExecState *s) {
+	int *r = m->registers;
+	r[instr->rd] = r[instr->rt] << (r[instr->rs] & 0x1f);
+	return TRUE;
+    }
+    static bool Slt(Machine *m, Instruction *instr, ExecState *s) {
+	int *r = m->registers;
+	r[instr->rd] = (r[instr->rs] < r[instr->rt]) ? 1 : 0;
+	return TRUE;
+    }
+    static bool Slti(Machine *m, Instruction *instr, ExecState *s) {
+	int *r = m->registers;
+	r[instr->rt] = (r[instr->rs] < instr->extra) ? 1 : 0;
+	return TRUE;
+    }
+    static bool Sltiu(Machine *m, Instruction *instr, ExecState *s) {
+	int *r = m->registers;
+	unsigned int rs = r[instr->rs];
+	unsigned int imm = instr->extra;
+	r[instr->rt] = (rs < imm) ? 1 : 0;
+	return TRUE;
+    }
+    static bool Sltu(Machine *m, Instruction *instr, ExecState *s) {
+	int *r = m->registers;
+	unsigned int rs = r[instr->rs];
+	unsigned int rt = r[instr->rt];
+	r[instr->rd] = (rs < rt) ? 1 : 0;
+	return TRUE;
+    }
+    static bool Sra(Machine *m, Instruction *instr, ExecState *s) {
+	m->registers[instr->rd] = m->registers[instr->rt] >> instr->extra;
+	return TRUE;
+    }
+    static bool Srav(Machine *m, Instruction *instr, ExecState *s) {
+	int *r = m->registers;
+	r[instr->rd] = r[instr->rt] >> (r[instr->rs] & 0x1f);
+	return TRUE;
+    }
+    static bool Srl(Machine *m, Instruction *instr, ExecState *s) {
+	int tmp = m->registers[instr->rt];	// NB: signed, as in
+	tmp >>= instr->extra;			// OneInstruction
+	m->registers[instr->rd] = tmp;
+	return TRUE;
+    }
+    static bool Srlv(Machine *m, Instruction *instr, ExecState *s) {
+	int *r = m->registers;
+	int tmp = r[instr->rt];
+	tmp >>= (r[instr->rs] & 0x1f);
+	r[instr->rd] = tmp;
+	return TRUE;
+    }
+    static bool Sub(Machine *m, Instruction *instr, ExecState *s) {
+	int *r = m->registers;
+	int diff = r[instr->rs] - r[instr->rt];
+	if (((r[instr->rs] ^ r[instr->rt]) & SIGN_BIT) &&
+	    ((r[instr->rs] ^ diff) & SIGN_BIT)) {
+	    m->RaiseException(OverflowException, 0);
+	    return FALSE;
+	}
+	r[instr->rd] = diff;
+	return TRUE;
+    }
+    static bool Subu(Machine *m, Instruction *instr, ExecState *s) {
+	int *r = m->registers;
+	r[instr->rd] = r[instr->rs] - r[instr->rt];
+	return TRUE;
+    }
+    static bool Sw(Machine *m, Instruction *instr, ExecState *s) {
+	int *r = m->registers;
+	return m->WriteMemory<FALSE>((unsigned) (r[instr->rs] + instr->extra), 4, 
+							r[instr->rt]);
+    }
+    static bool Swl(Machine *m, Instruction *instr, ExecState *s) {
+	int *r = m->registers;
+	int value;
+	int addr = r[instr->rs] + instr->extra;
+#ifdef SIM_FIX
+	int byte = addr & 0x3;
+	if (!m->ReadMemory<FALSE>(addr - byte, 4, &value))
+	    return FALSE;
+	int which = 3 - byte;
+	int aligned = addr - byte;
+#else
+	ASSERT((addr & 0x3) == 0);  
+	if (!m->ReadMemory<FALSE>((addr & ~0x3), 4, &value))
+	    return FALSE;
+	int which = addr & 0x3;
+	int aligned = addr & ~0x3;
+#endif
+	switch (which) {
+	  case 0: value = r[instr->rt]; break;
+	  case 1: value = (value & 0xff000000) | 
+			((r[instr->rt] >> 8) & 0xffffff); break;
+	  case 2: value = (value & 0xffff0000) | 
+			((r[instr->rt] >> 16) & 0xffff); break;
+	  case 3: value = (value & 0xffffff00) | 
+			((r[instr->rt] >> 24) & 0xff); break;
+	}
+	return m->WriteMemory<FALSE>(aligned, 4, value);
+    }
+    static bool Swr(Machine *m, Instruction *instr, ExecState *s) {
+	int *r = m->registers;
+	int value;
+	int addr = r[instr->rs] + instr->extra;
+#ifdef SIM_FIX
+	int byte = addr & 0x3;
+	if (!m->ReadMemory<FALSE>(addr - byte, 4, &value))
+	    return FALSE;
+	int which = 3 - byte;
+	int aligned = addr - byte;
+#else
+	ASSERT((addr & 0x3) == 0);  
+	if (!m->ReadMemory<FALSE>((addr & ~0x3), 4, &value))
+	    return FALSE;
+	int which = addr & 0x3;
+	int aligned = addr & ~0x3;
+#endif
+	switch (which) {
+	  case 0: value = (value & 0xffffff) | (r[instr->rt] << 24); break;
+	  case 1: value = (value & 0xffff) | (r[instr->rt] << 16); break;
+	  case 2: value = (value & 0xff) | (r[instr->rt] << 8); break;
+	  case 3: value = r[instr->rt]; break;
+	}
+	return m->WriteMemory<FALSE>(aligned, 4, value);
+    }
+    static bool Syscall(Machine *m, Instruction *instr, ExecState *s) {
+	m->RaiseException(SyscallException, 0);
+	return FALSE;
+    }
+    static bool Xor(Machine *m, Instruction *instr, ExecState *s) {
+	int *r = m->registers;
+	r[instr->rd] = r[instr->rs] ^ r[instr->rt];
+	return TRUE;
+    }
+    static bool Xori(Machine *m, Instruction *instr, ExecState *s) {
+	m->registers[instr->rt] = 
+		m->registers[instr->rs] ^ (instr->extra & 0xffff);
+	return TRUE;
+    }
+    static bool Illegal(Machine *m, Instruction *instr, ExecState *s) {
+	m->RaiseException(IllegalInstrException, 0);
+	return FALSE;
+    }
+    static bool Unknown(Machine *m, Instruction *instr, ExecState *s) {
+	ASSERT(FALSE);
+	return FALSE;
+    }
+
+    // A "superinstruction": "first" and then "second", run as one 
+    // operation.  "first" can't trap, load, or change the flow of
+    // control, so the only bookkeeping between the two is retiring any
+    // delayed load already in progress.  The caller advances the PC
+    // registers past "first" (and counts it) beforehand, so that if
+    // "second" traps, everything is just as if they had run separately.
+    template <InstrHandler first, InstrHandler second>
+    static bool Pair(Machine *m, Instruction *instr, ExecState *s) {
+	(void) (*first)(m, instr, s);
+	m->DelayedLoad(0, 0);
+	return (*second)(m, instr + 1, s);
+    }
+};
+
+//----------------------------------------------------------------------
+// ThreadedCode::HandlerFor
+// 	Return the routine that executes instructions with "opCode".
+//	Called once per instruction, when its page is decoded.
+//----------------------------------------------------------------------
+
+InstrHandler
+ThreadedCode::HandlerFor(int opCode)
+{
+    switch (opCode) {
+      case OP_ADD:	return Add;
+      case OP_ADDI:	return Addi;
+      case OP_ADDIU:	return Addiu;
+      case OP_ADDU:	return Addu;
+      case OP_AND:	return And;
+      case OP_ANDI:	return Andi;
+      case OP_BEQ:	return Beq;
+      case OP_BGEZ:	return Bgez;
+      case OP_BGEZAL:	return Bgezal;
+      case OP_BGTZ:	return Bgtz;
+      case OP_BLEZ:	return Blez;
+      case OP_BLTZ:	return Bltz;
+      case OP_BLTZAL:	return Bltzal;
+      case OP_BNE:	return Bne;
+      case OP_DIV:	return Div;
+      case OP_DIVU:	return Divu;
+      case OP_J:	return J;
+      case OP_JAL:	return Jal;
+      case OP_JALR:	return Jalr;
+      case OP_JR:	return Jr;
+      case OP_LB:
+      case OP_LBU:	return Lb;
+      case OP_LH:
+      case OP_LHU:	return Lh;
+      case OP_LUI:	return Lui;
+      case OP_LW:	return Lw;
+      case OP_LWL:	return Lwl;
+      case OP_LWR:	return Lwr;
+      case OP_MFHI:	return Mfhi;
+      case OP_MFLO:	return Mflo;
+      case OP_MTHI:	return Mthi;
+      case OP_MTLO:	return Mtlo;
+      case OP_MULT:	return Multiply;
+      case OP_MULTU:	return MultiplyU;
+      case OP_NOR:	return Nor;
+      case OP_OR:	return Or;
+      case OP_ORI:	return Ori;
+      case OP_SB:	return Sb;
+      case OP_SH:	return Sh;
+      case OP_SLL:	return Sll;
+      case OP_SLLV:	return Sllv;
+      case OP_SLT:	return Slt;
+      case OP_SLTI:	return Slti;
+      case OP_SLTIU:	return Sltiu;
+      case OP_SLTU:	return Sltu;
+      case OP_SRA:	return Sra;
+      case OP_SRAV:	return Srav;
+      case OP_SRL:	return Srl;
+      case OP_SRLV:	return Srlv;
+      case OP_SUB:	return Sub;
+      case OP_SUBU:	return Subu;
+      case OP_SW:	return Sw;
+      case OP_SWL:	return Swl;
+      case OP_SWR:	return Swr;
+      case OP_SYSCALL:	return Syscall;
+      case OP_XOR:	return Xor;
+      case OP_XORI:	return Xori;
+      case OP_RES:
+      case OP_UNIMP:	return Illegal;
+      default:		return Unknown;
+    }
+}
+
+//----------------------------------------------------------------------
+// ThreadedCode::PairFor
+// 	Return the routine that executes "first" and "second" (the
+//	instruction after it) as a single operation, or NULL if they are
+//	not one of the idioms the compiler uses all the time:
+//
+//	lui+ori, lui+addiu		building a 32-bit constant
+//	lui/addiu/addu+lw		address arithmetic, then a load
+//	addiu/addu+sw			adjusting sp, then saving ra
+//	slt/slti/sltu/sltiu+beq/bne	compare and branch
+//
+//	Called once per instruction, when its page is decoded.
+//----------------------------------------------------------------------
+
+InstrHandler
+ThreadedCode::PairFor(Instruction *first, Instruction *second)
+{
+    switch (first->opCode) {
+      case OP_LUI:
+	switch (second->opCode) {
+	  case OP_ORI:		return Pair<Lui, Ori>;
+	  case OP_ADDIU:	return Pair<Lui, Addiu>;
+	  case OP_LW:		return Pair<Lui, Lw>;
+	  default:		return NULL;
+	}
+      case OP_ADDIU:
+	switch (second->opCode) {
+	  case OP_LW:		return Pair<Addiu, Lw>;
+	  case OP_SW:		return Pair<Addiu, Sw>;
+	  default:		return NULL;
+	}
+      case OP_ADDU:
+	switch (second->opCode) {
+	  case OP_LW:		return Pair<Addu, Lw>;
+	  case OP_SW:		return Pair<Addu, Sw>;
+	  default:		return NULL;
+	}
+      case OP_SLT:
+	switch (second->opCode) {
+	  case OP_BEQ:		return Pair<Slt, Beq>;
+	  case OP_BNE:		return Pair<Slt, Bne>;
+	  default:		return NULL;
+	}
+      case OP_SLTI:
+	switch (second->opCode) {
+	  case OP_BEQ:		return Pair<Slti, Beq>;
+	  case OP_BNE:		return Pair<Slti, Bne>;
+	  default:		return NULL;
+	}
+      case OP_SLTU:
+	switch (second->opCode) {
+	  case OP_BEQ:		return Pair<Sltu, Beq>;
+	  case OP_BNE:		return Pair<Sltu, Bne>;
+	  default:		return NULL;
+	}
+      case OP_SLTIU:
+	switch (second->opCode) {
+	  case OP_BEQ:		return Pair<Sltiu, Beq>;
+	  case OP_BNE:		return Pair<Sltiu, Bne>;
+	  default:		return NULL;
+	}
+      default:
+	return NULL;
+    }
+}
+
+//----------------------------------------------------------------------
+// ThreadedCode::EndsBlock
+// 	Return TRUE if an instruction with "opCode" must be the last one
+//	of a basic block: it may change the flow of control, or it always
+//	traps to the kernel.
+//----------------------------------------------------------------------
+
+bool
+ThreadedCode::EndsBlock(int opCode)
+{
+    switch (opCode) {
+      case OP_SYSCALL: case OP_RES: case OP_UNIMP:
+	return TRUE;
+      default:
+	return IsBranch(opCode) || (HandlerFor(opCode) == Unknown);
+    }
+}
+
+//----------------------------------------------------------------------
+// ThreadedCode::IsBranch
+// 	Return TRUE if an instruction with "opCode" is a branch or jump,
+//	and so is followed by a delay slot.
+//----------------------------------------------------------------------
+
+bool
+ThreadedCode::IsBranch(int opCode)
+{
+    switch (opCode) {
+      case OP_BEQ: case OP_BGEZ: case OP_BGEZAL: case OP_BGTZ:
+      case OP_BLEZ: case OP_BLTZ: case OP_BLTZAL: case OP_BNE:
+      case OP_J: case OP_JAL: case OP_JALR: case OP_JR:
+	return TRUE;
+      default:
+	return FALSE;
+    }
+}
+
+//----------------------------------------------------------------------
+// ThreadedCode::MayTrap
+// 	Return TRUE if an instruction with "opCode" can raise an exception:
+//	loads and stores (address errors, page faults), signed arithmetic
+//	(overflow), and traps.
+//----------------------------------------------------------------------
+
+bool
+ThreadedCode::MayTrap(int opCode)
+{
+    switch (opCode) {
+      case OP_ADD: case OP_ADDI: case OP_SUB:
+      case OP_LB: case OP_LBU: case OP_LH: case OP_LHU:
+      case OP_LW: case OP_LWL: case OP_LWR:
+      case OP_SYSCALL: case OP_RES: case OP_UNIMP:
+	return TRUE;
+      default:
+	return WritesMemory(opCode) || (HandlerFor(opCode) == Unknown);
+    }
+}
+
+//----------------------------------------------------------------------
+// ThreadedCode::WritesMemory
+// 	Return TRUE if an instruction with "opCode" is a store.
+//----------------------------------------------------------------------
+
+bool
+ThreadedCode::WritesMemory(int opCode)
+{
+    switch (opCode) {
+      case OP_SB: case OP_SH: case OP_SW: case OP_SWL: case OP_SWR:
+	return TRUE;
+      default:
+	return FALSE;
+    }
+}
+
+//----------------------------------------------------------------------
+// Machine::RunBlock
+// 	Execute the basic block starting at the current PC, using the
+//	threaded-code handlers, as part of a batch (see RunBatch).  Each
+//	instruction that retires is counted in *blockTicks.
+//
+//	The block is the straight-line run of instructions up to and 
+//	including the next branch, jump or trap (the delay slot of a 
+//	branch starts the following block).  The PC is translated only once 
+//	per block: a block never crosses a page boundary.  If we are in a
+//	branch delay slot, just the delay slot instruction is run.  No
+//	more than "limit" ticks' worth of instructions are run (one tick
+//	each, plus any cache stalls), so the batch ends exactly when the
+//	next interrupt is due.
+//
+//	Where DecodePage found a pair of instructions worth fusing, and
+//	both are in what we are to run, they are run by one call to the 
+//	pair's handler; the state and ticks come out the same.  (Not
+//	when modeling caches: a stall can end the batch between the two.)
+//
+//	With CompileEngine, a block that has been run HotBlockThreshold
+//	times is compiled, and from then on run by RunCompiled instead.
+//
+//	Returns FALSE if an instruction (or the fetch) trapped.
+//----------------------------------------------------------------------
+
+bool
+Machine::RunBlock(int limit)
+{
+    Instruction *instr, *end;
+    ExecState state;
+    int pageFrame;
+    int stop = *blockTicks + limit;
+
+    if ((instr = FetchInstruction<FALSE>()) == NULL)
+	return FALSE;
+    if (registers[NextPCReg] == registers[PCReg] + 4) {
+	if ((instr->compiled != NULL) && (instr->compiled->length <= limit))
+	    return RunCompiled(instr->compiled);
+	if ((execEngine == CompileEngine) && (instr->compiled == NULL) &&
+			(++instr->timesRun == HotBlockThreshold))
+	    instr->compiled = CompileBlock(instr);
+	end = instr + min(instr->blockLength, limit);
+    } else
+	end = instr + 1;		// branch delay slot
+    pageFrame = (instr - decodeCache) / (PageSize / 4);
+
+    for (; instr < end; instr++) {
+	InstrHandler handler = instr->handler;
+	Instruction *first = instr;
+
+	if ((instr->pair != NULL) && (instr + 1 < end)) {
+	    handler = instr->pair;	// retire the first of the pair 
+	    registers[PrevPCReg] = registers[PCReg];	// up front
+	    registers[PCReg] = registers[NextPCReg];
+	    registers[NextPCReg] += 4;
+	    (*blockTicks)++;
+	    instr++;
+	}
+	state.pcAfter = registers[NextPCReg] + 4;
+	state.loadReg = 0;
+	state.loadValue = 0;
+	if (icache != NULL)
+	    CacheAccess(icache, (instr - decodeCache) * 4);
+	if (!(*handler)(this, first, &state))
+	    return FALSE;		// RaiseException has charged for
+					// the instructions before it
+	DelayedLoad(state.loadReg, state.loadValue);
+	registers[PrevPCReg] = registers[PCReg];
+	registers[PCReg] = registers[NextPCReg];
+	registers[NextPCReg] = state.pcAfter;
+	(*blockTicks)++;
+	if (!pageDecoded[pageFrame])	// the block wrote over its own
+	    break;			// page; re-fetch from here
+	if (*blockTicks >= stop)	// cache stalls used up the batch
+	    break;
+    }
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// Machine::CompileBlock
+// 	Compile the basic block starting at "first", because it has been
+//	run often enough that it is worth it.
+//
+//	Each instruction's handler is copied out along with what we need
+//	to know to run it without the generic bookkeeping of RunBlock: 
+//	whether it can trap, and whether it can write over the block.
+//	If the block ends with a branch or jump, its delay slot is made 
+//	part of the block too (unless it is on the next page, or is itself
+//	a branch or trap), so the pair doesn't take two trips through
+//	RunBlock.  Fused pairs of instructions (see PairFor) are kept, 
+//	except that a pair can't straddle the end of the block; a compare
+//	fused with the branch is run along with the branch.
+//----------------------------------------------------------------------
+
+CompiledBlock *
+Machine::CompileBlock(Instruction *first)
+{
+    int wordsPerPage = PageSize / 4;
+    int pageFrame = (first - decodeCache) / wordsPerPage;
+    Instruction *last = first + first->blockLength - 1;
+    Instruction *pageEnd = decodeCache + (pageFrame + 1) * wordsPerPage;
+    bool branch = ThreadedCode::IsBranch(last->opCode);
+    CompiledBlock *block;
+    int length = first->blockLength;
+
+    if (branch && (last + 1 < pageEnd) && 
+			!ThreadedCode::EndsBlock((last + 1)->opCode))
+	length++;			// take the delay slot along
+    DEBUG(dbgMach, "Compiling block at physical address " << 
+		(first - decodeCache) * 4 << ", " << length << " instructions");
+
+    block = new CompiledBlock(length);
+    block->straight = branch ? first->blockLength - 1 : first->blockLength;
+    block->pageFrame = pageFrame;
+    for (int i = 0; i < length; i++) {
+	CompiledOp *op = &block->ops[i];
+
+	op->instr = first + i;
+	op->handler = op->instr->handler;
+	op->pair = (i + 1 < length) ? op->instr->pair : NULL;
+	op->mayTrap = ThreadedCode::MayTrap(op->instr->opCode);
+	op->writesMemory = ThreadedCode::WritesMemory(op->instr->opCode);
+    }
+    if (branch && (block->straight > 0) && 
+			(block->ops[block->straight - 1].pair != NULL))
+	block->straight--;		// compare and branch: run the
+					// compare along with the branch
+    return block;
+}
+
+//----------------------------------------------------------------------
+// Machine::RunCompiled
+// 	Run a compiled basic block, starting at the current PC, as part
+//	of a batch (see RunBatch).  Each instruction that retires is 
+//	counted in *blockTicks.  The caller checks that the whole block
+//	fits in the batch.
+//
+//	The instructions before the branch or jump ending the block can't
+//	change the flow of control, so their PCs are known in advance: we
+//	keep the PC in a local, and only store it back into the PC
+//	registers before an instruction that might trap (the kernel needs 
+//	to see where it was), and at the end.  Likewise a delayed load only
+//	has to be applied if one is actually in progress.  The branch and 
+//	its delay slot are run exactly as RunBlock runs them.  A fused
+//	pair counts as two instructions, both retired by the time the
+//	second might trap.
+//
+//	Otherwise this behaves as RunBlock does, instruction for 
+//	instruction and tick for tick: a trap or a write to the block's
+//	own page ends the block early, falling back to RunBlock (and 
+//	recompiling the page's hot blocks, once they are run again).
+//
+//	Note that once an instruction traps, "block" may have been
+//	deleted -- the kernel may have run other user code that rewrote
+//	the page -- so we must not touch it again.
+//
+//	Returns FALSE if an instruction trapped.
+//----------------------------------------------------------------------
+
+bool
+Machine::RunCompiled(CompiledBlock *block)
+{
+    CompiledOp *op = block->ops;
+    CompiledOp *straightEnd = op + block->straight;
+    CompiledOp *end = op + block->length;
+    int pageFrame = block->pageFrame;
+    ExecState state;
+    int pc = registers[PCReg];
+    bool synced = TRUE;		// are the PC registers up to date?
+    bool loading = TRUE;	// might a delayed load be in progress?
+
+    for (; op < straightEnd; op++) {
+	InstrHandler handler = op->handler;
+	Instruction *first = op->instr;
+
+	if (op->pair != NULL) {		// count the first of the pair as
+	    handler = op->pair;		// retired; from here on "op" is
+	    pc += 4;			// the second one
+	    synced = FALSE;
+	    (*blockTicks)++;
+	    op++;
+	}
+	state.loadReg = 0;
+	state.loadValue = 0;
+	if (op->mayTrap) {
+	    if (!synced) {
+		registers[PrevPCReg] = pc - 4;
+		registers[PCReg] = pc;
+		registers[NextPCReg] = pc + 4;
+		synced = TRUE;
+	    }
+	    if (!(*handler)(this, first, &state))
+		return FALSE;
+	} else
+	    (void) (*handler)(this, first, &state);
+	if (loading || (state.loadReg != 0) || (state.loadValue != 0)) {
+	    DelayedLoad(state.loadReg, state.loadValue);
+	    loading = (state.loadReg != 0) || (state.loadValue != 0);
+	} else
+	    registers[0] = 0;		// as DelayedLoad would
+	pc += 4;
+	synced = FALSE;
+	(*blockTicks)++;
+	if (op->writesMemory && !pageDecoded[pageFrame])
+	    break;			// the block wrote over its own page
+    }
+    if (!synced) {
+	registers[PrevPCReg] = pc - 4;
+	registers[PCReg] = pc;
+	registers[NextPCReg] = pc + 4;
+    }
+    if (op < straightEnd)
+	return TRUE;
+    for (; op < end; op++) {		// the branch, and its delay slot
+	InstrHandler handler = op->handler;
+	Instruction *first = op->instr;
+
+	if (op->pair != NULL) {		// a compare fused with the branch
+	    handler = op->pair;
+	    registers[PrevPCReg] = registers[PCReg];
+	    registers[PCReg] = registers[NextPCReg];
+	    registers[NextPCReg] += 4;
+	    (*blockTicks)++;
+	    op++;
+	}
+	state.pcAfter = registers[NextPCReg] + 4;
+	state.loadReg = 0;
+	state.loadValue = 0;
+	if (!(*handler)(this, first, &state))
+	    return FALSE;
+	DelayedLoad(state.loadReg, state.loadValue);
+	registers[PrevPCReg] = registers[PCReg];
+	registers[PCReg] = registers[NextPCReg];
+	registers[NextPCReg] = state.pcAfter;
+	(*blockTicks)++;
+	if (!pageDecoded[pageFrame])
+	    break;
+    }
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// Machine::FetchInstruction
+// 	Fetch the instruction at the current PC, already decoded.
+//
+//	The address is translated as a read would be (so page faults, the 
+//	use bit, etc. all behave as they did before, and the translation
+//	is cached in readCache), but rather than reading and decoding the
+//	word every time, we look it up in the decode cache, which is 
+//	indexed by physical address.  Since the cache is physical,
+//	changing the page table never makes an entry stale; only a change
+//	to the contents of the page does, and all of those go through
+//	WriteMem or InvalidateDecodedPage.
+//
+//	Returns NULL if the translation raised an exception.
+//----------------------------------------------------------------------
+
+template <bool tracing> Instruction *
+Machine::FetchInstruction()
+{
+    ExceptionType exception;
+    int pc = registers[PCReg];
+    unsigned int vpn = (unsigned) pc / PageSize;
+    HostTranslation *cached = &readCache[vpn % HostCacheSize];
+    int physAddr;
+    int pageFrame;
+
+    if ((cached->virtualPage == vpn) && !(pc & 0x3)) {
+	pageFrame = cached->physicalPage;
+	physAddr = pageFrame * PageSize + (unsigned) pc % PageSize;
+    } else {
+	exception = Translate<tracing>(pc, &physAddr, 4, FALSE);
+	if (exception != NoException) {
+	    RaiseException(exception, pc);
+	    return NULL;
+	}
+	pageFrame = physAddr / PageSize;
+	if (!tracing)
+	    CacheTranslation(cached, vpn, pageFrame);
+    }
+    if (!pageDecoded[pageFrame])
+	DecodePage(pageFrame);
+    return &decodeCache[physAddr / 4];
+}
+
+//----------------------------------------------------------------------
+// Machine::DecodePage
+// 	Decode every word of physical page "pageFrame" into the decode
+//	cache.  A page is decoded as a whole the first time any instruction
+//	on it is fetched; decoding a data word that is never executed is
+//	harmless.  Pairs of instructions that are worth running as one
+//	are found here too.  Any blocks compiled from the old contents are
+//	thrown away.
+//----------------------------------------------------------------------
+
+void
+Machine::DecodePage(int pageFrame)
+{
+    int first = (pageFrame * PageSize) / 4;
+    int last = first + PageSize / 4;
+
+    DEBUG(dbgMach, "Decoding physical page " << pageFrame);
+    for (int i = last - 1; i >= first; i--) {	// backwards, so we know
+						// the length of the block
+						// that follows
+	Instruction *instr = &decodeCache[i];
+
+	if (instr->compiled != NULL) {
+	    delete instr->compiled;
+	    instr->compiled = NULL;
+	}
+	instr->timesRun = 0;
+	instr->value = WordToHost(*(unsigned int *) &mainMemory[i * 4]);
+	instr->Decode();
+	instr->handler = ThreadedCode::HandlerFor(instr->opCode);
+	if ((i == last - 1) || ThreadedCode::EndsBlock(instr->opCode)) {
+	    instr->blockLength = 1;
+	    instr->pair = NULL;
+	} else {
+	    instr->blockLength = decodeCache[i + 1].blockLength + 1;
+	    instr->pair = (icache == NULL) ? 
+			ThreadedCode::PairFor(instr, instr + 1) : NULL;
+	}
+    }
+    pageDecoded[pageFrame] = TRUE;
+}
+
+//----------------------------------------------------------------------
+// Machine::InvalidateDecodedPage
+// 	Forget the decoded instructions for physical page "pageFrame",
+//	because its contents have changed.
+//----------------------------------------------------------------------
+
+void
+Machine::InvalidateDecodedPage(int pageFrame)
+{
+    ASSERT((pageFrame >= 0) && (pageFrame < NumPhysPages));
+    pageDecoded[pageFrame] = FALSE;
 }
 
 //----------------------------------------------------------------------
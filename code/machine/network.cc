@@ -65,12 +65,13 @@ NetworkInput::CallBack()
 
     if (inHdr.length != 0) 	// do nothing if packet is already buffered
 	return;		
-    if (!PollSocket(sock)) 	// do nothing if no packet to be read
-	return;
 
-    // otherwise, read packet in
+    // read packet in, if there is one
     char *buffer = new char[MaxWireSize];
-    ReadFromSocket(sock, buffer, MaxWireSize);
+    if (!kernel->eventLog->ReadNetwork(sock, buffer, MaxWireSize)) {
+	delete [] buffer;	// do nothing if no packet to be read
+	return;
+    }
 
     // divide packet into header and data
     inHdr = *(PacketHeader *)buffer;
@@ -168,11 +169,15 @@ NetworkOutput::Send(PacketHeader hdr, char* data)
 
     kernel->interrupt->Schedule(this, NetworkTime, NetworkSendInt);
 
-    if (RandomNumber() % 100 >= chanceToWork * 100) { // emulate a lost packet
+    if (kernel->eventLog->Random() % 100 >= chanceToWork * 100) { 
+					// emulate a lost packet
 	DEBUG(dbgNet, "oops, lost it!");
 	return;
     }
 
+    if (kernel->eventLog->IsReplaying()) // the other end was recorded
+	return;
+
     // concatenate hdr and data into a single buffer, and send it out
     char *buffer = new char[MaxWireSize];
     *(PacketHeader *)buffer = hdr;
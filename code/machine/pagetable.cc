@@ -0,0 +1,281 @@
+// pagetable.cc
+//	Routines to keep the translations of an address space in each of
+//	the kinds of page table: see pagetable.h.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "pagetable.h"
+#include "machine.h"
+#include "debug.h"
+
+//----------------------------------------------------------------------
+// PageTable::Use
+// 	Account for "bytes" more memory taken up by the table (fewer,
+//	if negative), keeping track of the most it has ever taken.
+//----------------------------------------------------------------------
+
+void
+PageTable::Use(int bytes)
+{
+    bytesUsed += bytes;
+    if (bytesUsed > peakBytesUsed)
+	peakBytesUsed = bytesUsed;
+}
+
+//----------------------------------------------------------------------
+// ClearEntry
+// 	Set "entry" up to translate page "vpn" to "frame", with the use
+//	and dirty bits clear.
+//----------------------------------------------------------------------
+
+static void
+ClearEntry(TranslationEntry *entry, int vpn, int frame)
+{
+    entry->virtualPage = vpn;
+    entry->physicalPage = frame;
+    entry->valid = TRUE;
+    entry->readOnly = FALSE;
+    entry->use = FALSE;
+    entry->dirty = FALSE;
+}
+
+//----------------------------------------------------------------------
+// LinearTable::LinearTable
+// 	Allocate an entry for each of the "pages" pages, none of them
+//	in memory.
+//----------------------------------------------------------------------
+
+LinearTable::LinearTable(int pages) : PageTable(pages)
+{
+    table = new TranslationEntry[numPages];
+    for (int i = 0; i < numPages; i++) {
+	table[i].virtualPage = i;
+	table[i].physicalPage = -1;
+	table[i].valid = FALSE;
+	table[i].readOnly = FALSE;
+	table[i].use = FALSE;
+	table[i].dirty = FALSE;
+    }
+    Use(numPages * sizeof(TranslationEntry));
+}
+
+LinearTable::~LinearTable()
+{
+    delete [] table;
+}
+
+//----------------------------------------------------------------------
+// LinearTable::Map, LinearTable::Unmap
+// 	Set or clear the valid bit of the entry for page "vpn".
+//----------------------------------------------------------------------
+
+TranslationEntry *
+LinearTable::Map(int vpn, int frame)
+{
+    ASSERT((vpn >= 0) && (vpn < numPages));
+    ClearEntry(&table[vpn], vpn, frame);
+    return &table[vpn];
+}
+
+void
+LinearTable::Unmap(int vpn)
+{
+    ASSERT(table[vpn].valid);
+    table[vpn].valid = FALSE;
+}
+
+//----------------------------------------------------------------------
+// TwoLevelTable::TwoLevelTable
+// 	Allocate the directory for "pages" pages, with no second-level
+//	tables yet.
+//----------------------------------------------------------------------
+
+TwoLevelTable::TwoLevelTable(int pages) : PageTable(pages)
+{
+    directorySize = divRoundUp(numPages, PageTableLeafSize);
+    directory = new TranslationEntry *[directorySize];
+    numMapped = new int[directorySize];
+    for (int i = 0; i < directorySize; i++) {
+	directory[i] = NULL;
+	numMapped[i] = 0;
+    }
+    Use(directorySize * (sizeof(TranslationEntry *) + sizeof(int)));
+}
+
+TwoLevelTable::~TwoLevelTable()
+{
+    for (int i = 0; i < directorySize; i++)
+	if (directory[i] != NULL)
+	    delete [] directory[i];
+    delete [] directory;
+    delete [] numMapped;
+}
+
+//----------------------------------------------------------------------
+// TwoLevelTable::Map
+// 	Make page "vpn" translate to "frame", allocating the second-level
+//	table for it if none of its neighbours is in memory.
+//----------------------------------------------------------------------
+
+TranslationEntry *
+TwoLevelTable::Map(int vpn, int frame)
+{
+    int dir = vpn / PageTableLeafSize;
+    TranslationEntry *entry;
+
+    ASSERT((vpn >= 0) && (vpn < numPages));
+    if (directory[dir] == NULL) {
+	DEBUG(dbgAddr, "Allocating second-level page table " << dir);
+	directory[dir] = new TranslationEntry[PageTableLeafSize];
+	for (int i = 0; i < PageTableLeafSize; i++)
+	    directory[dir][i].valid = FALSE;
+	Use(PageTableLeafSize * sizeof(TranslationEntry));
+    }
+    entry = &directory[dir][vpn % PageTableLeafSize];
+    if (!entry->valid)
+	numMapped[dir]++;
+    ClearEntry(entry, vpn, frame);
+    return entry;
+}
+
+//----------------------------------------------------------------------
+// TwoLevelTable::Unmap
+// 	Page "vpn" is no longer in memory; free its second-level table if
+//	none of its neighbours is either.
+//----------------------------------------------------------------------
+
+void
+TwoLevelTable::Unmap(int vpn)
+{
+    int dir = vpn / PageTableLeafSize;
+
+    ASSERT(Lookup(vpn) != NULL);
+    directory[dir][vpn % PageTableLeafSize].valid = FALSE;
+    if (--numMapped[dir] == 0) {
+	delete [] directory[dir];
+	directory[dir] = NULL;
+	Use(-(int) (PageTableLeafSize * sizeof(TranslationEntry)));
+    }
+}
+
+// The shared inverted page table
+
+TranslationEntry *InvertedTable::entries = NULL;
+int *InvertedTable::owner = NULL;
+int *InvertedTable::next = NULL;
+int *InvertedTable::anchor = NULL;
+int InvertedTable::nextId = 0;
+int InvertedTable::numTables = 0;
+
+//----------------------------------------------------------------------
+// InvertedTable::InvertedTable
+// 	Give a new address space of "pages" pages its id in the inverted
+//	page table, allocating the table first if it is the only one.
+//----------------------------------------------------------------------
+
+InvertedTable::InvertedTable(int pages) : PageTable(pages)
+{
+    if (numTables++ == 0) {
+	entries = new TranslationEntry[NumPhysPages];
+	owner = new int[NumPhysPages];
+	next = new int[NumPhysPages];
+	anchor = new int[NumPhysPages];
+	for (int i = 0; i < NumPhysPages; i++) {
+	    entries[i].valid = FALSE;
+	    owner[i] = -1;
+	    anchor[i] = -1;
+	}
+    }
+    id = nextId++;
+}
+
+//----------------------------------------------------------------------
+// InvertedTable::~InvertedTable
+// 	Take our entries out of the inverted page table, and free it if
+//	no other address space is using it.
+//----------------------------------------------------------------------
+
+InvertedTable::~InvertedTable()
+{
+    for (int i = 0; i < NumPhysPages; i++)
+	if (owner[i] == id)
+	    Unmap(entries[i].virtualPage);
+    if (--numTables == 0) {
+	delete [] entries;
+	delete [] owner;
+	delete [] next;
+	delete [] anchor;
+	entries = NULL;
+    }
+}
+
+//----------------------------------------------------------------------
+// InvertedTable::Hash
+// 	Return the chain to look for page "vpn" of table "space" in.
+//----------------------------------------------------------------------
+
+int
+InvertedTable::Hash(int space, int vpn)
+{
+    return ((unsigned int) (vpn * 31 + space * 17)) % NumPhysPages;
+}
+
+//----------------------------------------------------------------------
+// InvertedTable::Lookup
+// 	Follow the chain for page "vpn" to the frame holding it.
+//----------------------------------------------------------------------
+
+TranslationEntry *
+InvertedTable::Lookup(unsigned int vpn)
+{
+    if (vpn >= (unsigned) numPages)
+	return NULL;
+    for (int i = anchor[Hash(id, vpn)]; i >= 0; i = next[i])
+	if ((owner[i] == id) && (entries[i].virtualPage == (int) vpn))
+	    return &entries[i];
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// InvertedTable::Map
+// 	Fill in the entry of "frame", which must be free, to hold page
+//	"vpn", and put it at the head of the page's chain.
+//----------------------------------------------------------------------
+
+TranslationEntry *
+InvertedTable::Map(int vpn, int frame)
+{
+    int chain = Hash(id, vpn);
+
+    ASSERT((vpn >= 0) && (vpn < numPages));
+    ASSERT(owner[frame] < 0);
+    ClearEntry(&entries[frame], vpn, frame);
+    owner[frame] = id;
+    next[frame] = anchor[chain];
+    anchor[chain] = frame;
+    Use(sizeof(TranslationEntry) + 2 * sizeof(int));
+    return &entries[frame];
+}
+
+//----------------------------------------------------------------------
+// InvertedTable::Unmap
+// 	Take the entry for page "vpn" out of its chain, and free it.
+//----------------------------------------------------------------------
+
+void
+InvertedTable::Unmap(int vpn)
+{
+    int *link = &anchor[Hash(id, vpn)];
+
+    while ((*link >= 0) &&
+	    !((owner[*link] == id) && (entries[*link].virtualPage == vpn)))
+	link = &next[*link];
+    ASSERT(*link >= 0);
+    owner[*link] = -1;
+    entries[*link].valid = FALSE;
+    *link = next[*link];
+    Use(-(int) (sizeof(TranslationEntry) + 2 * sizeof(int)));
+}
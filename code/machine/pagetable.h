@@ -0,0 +1,155 @@
+// pagetable.h
+//	Data structures for the page tables the simulated machine can
+//	translate through, when it has no TLB.
+//
+//	All of them map a virtual page number to a TranslationEntry, but
+//	keep the entries in different ways:
+//
+//	   linear -- one entry for every page of the address space,
+//		whether or not it is in memory
+//	   two-level -- a directory of pointers to second-level tables of
+//		PageTableLeafSize entries, which are only allocated while
+//		some page they cover is in memory
+//	   inverted -- one entry for every physical page frame, shared by
+//		all address spaces, found by hashing the address space
+//		and the virtual page number
+//
+//	Only pages in memory have an entry that Lookup finds.  The kind
+//	of page table is chosen for the whole run, with
+//	"-pt linear|2level|inverted".
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef PAGETABLE_H
+#define PAGETABLE_H
+
+#include "copyright.h"
+#include "utility.h"
+#include "translate.h"
+
+// The kinds of page table there are.
+
+enum PageTableKind { LinearPageTable, TwoLevelPageTable, InvertedPageTable };
+
+const int PageTableLeafSize = 32;	// entries in each second-level
+					// table of a two-level page table
+
+// The following class defines the interface all the page tables
+// provide -- to the machine, to look up a translation, and to the
+// kernel, to change one.
+
+class PageTable {
+  public:
+    PageTable(int pages) { numPages = pages; bytesUsed = peakBytesUsed = 0; }
+    virtual ~PageTable() {}
+
+    int NumPages() { return numPages; }
+				// Pages in the address space
+    virtual TranslationEntry *Lookup(unsigned int vpn) = 0;
+				// Return the entry for page "vpn", or NULL
+				// if it is not in memory
+    virtual TranslationEntry *Map(int vpn, int frame) = 0;
+				// Make page "vpn" translate to "frame",
+				// with the use and dirty bits clear
+    virtual void Unmap(int vpn) = 0;
+				// Page "vpn" is no longer in memory
+    virtual bool CanShareFrames() { return TRUE; }
+				// May a frame mapped by another table be
+				// mapped by this one too (see
+				// AddrSpace::Fork)?
+
+    int BytesUsed() { return bytesUsed; }
+    int PeakBytesUsed() { return peakBytesUsed; }
+				// Memory the table takes up, now and at
+				// most so far
+
+  protected:
+    void Use(int bytes);	// The table takes up "bytes" more (or
+				// less, if negative)
+
+    int numPages;
+    int bytesUsed;
+    int peakBytesUsed;
+};
+
+// A flat array, indexed by virtual page number.
+
+class LinearTable : public PageTable {
+  public:
+    LinearTable(int pages);
+    ~LinearTable();
+
+    TranslationEntry *Lookup(unsigned int vpn) {
+	if ((vpn >= (unsigned) numPages) || !table[vpn].valid)
+	    return NULL;
+	return &table[vpn];
+    }
+    TranslationEntry *Map(int vpn, int frame);
+    void Unmap(int vpn);
+
+  private:
+    TranslationEntry *table;
+};
+
+// A directory indexed by the high bits of the virtual page number,
+// pointing to second-level tables indexed by the low bits.
+
+class TwoLevelTable : public PageTable {
+  public:
+    TwoLevelTable(int pages);
+    ~TwoLevelTable();
+
+    TranslationEntry *Lookup(unsigned int vpn) {
+	TranslationEntry *leaf;
+
+	if (vpn >= (unsigned) numPages)
+	    return NULL;
+	leaf = directory[vpn / PageTableLeafSize];
+	if ((leaf == NULL) || !leaf[vpn % PageTableLeafSize].valid)
+	    return NULL;
+	return &leaf[vpn % PageTableLeafSize];
+    }
+    TranslationEntry *Map(int vpn, int frame);
+    void Unmap(int vpn);
+
+  private:
+    TranslationEntry **directory;	// NULL where no page of a leaf
+					// is in memory
+    int *numMapped;			// pages in memory, for each leaf
+    int directorySize;
+};
+
+// A view of the inverted page table for one address space: the
+// entries themselves are shared, one per physical frame, in chains
+// hanging off a hash anchor table.  An address space's share of the
+// memory is that of the entries it has.
+
+class InvertedTable : public PageTable {
+  public:
+    InvertedTable(int pages);
+    ~InvertedTable();
+
+    TranslationEntry *Lookup(unsigned int vpn);
+    TranslationEntry *Map(int vpn, int frame);
+    void Unmap(int vpn);
+    bool CanShareFrames() { return FALSE; }
+				// a frame has only the one entry
+
+  private:
+    static int Hash(int space, int vpn);
+
+    int id;			// tags our entries in the shared table
+
+    static TranslationEntry *entries;	// one per frame
+    static int *owner;		// the id of the table each entry is
+				// in, or -1 if the frame is free
+    static int *next;		// the next frame in the same chain
+    static int *anchor;		// the first frame in each chain
+    static int nextId;		// to hand out to the next table
+    static int numTables;	// the shared table is allocated while
+				// there are any
+};
+
+#endif // PAGETABLE_H
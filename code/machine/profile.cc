@@ -0,0 +1,273 @@
+// profile.cc
+//	Routines to count where user programs spend their time, and to
+//	report it when Nachos halts.
+//
+//	The report is meant to be read by programs as well as people (so
+//	that two runs can be compared with diff): one record per line,
+//	each starting with its kind, with fields separated by spaces.
+//
+//	total <instructions> <branches taken>
+//	proc <count> <percent> <procedure>
+//		instructions executed in each procedure, most first
+//	pc <address> <count> <percent> <procedure+offset>
+//		times each instruction was executed, most first
+//	target <address> <count> <procedure+offset>
+//		times each address was branched or jumped to, most first
+//
+//	Ties are broken by address (or name), so the order is always the
+//	same.  If the program has no symbol table, procedures are "-".
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "profile.h"
+#include "debug.h"
+#include "sysdep.h"
+
+// One line of a report section, before it is sorted.
+
+class ProfileEntry {
+  public:
+    int address;		// a PC, or a procedure's index in symbols
+    int count;
+};
+
+//----------------------------------------------------------------------
+// CompareEntries, CompareSymbols
+// 	Orderings for qsort: entries by decreasing count, then by
+//	address; symbols by address.
+//----------------------------------------------------------------------
+
+static int
+CompareEntries(const void *a, const void *b)
+{
+    ProfileEntry *x = (ProfileEntry *) a;
+    ProfileEntry *y = (ProfileEntry *) b;
+
+    if (x->count != y->count)
+	return (x->count > y->count) ? -1 : 1;
+    return (x->address < y->address) ? -1 : (x->address > y->address);
+}
+
+static int
+CompareSymbols(const void *a, const void *b)
+{
+    ProfileSymbol *x = (ProfileSymbol *) a;
+    ProfileSymbol *y = (ProfileSymbol *) b;
+
+    if (x->address != y->address)
+	return (x->address < y->address) ? -1 : 1;
+    return strcmp(x->name, y->name);
+}
+
+//----------------------------------------------------------------------
+// Profile::Profile
+// 	Initialize an empty profile.
+//
+//	"fileName" -- the UNIX file to write the report to
+//----------------------------------------------------------------------
+
+Profile::Profile(char *fileName)
+{
+    this->fileName = fileName;
+    numWords = 0;
+    pcCounts = NULL;
+    targetCounts = NULL;
+    numSymbols = 0;
+    maxSymbols = 0;
+    symbols = NULL;
+}
+
+//----------------------------------------------------------------------
+// Profile::~Profile
+// 	De-allocate the counts and symbols.
+//----------------------------------------------------------------------
+
+Profile::~Profile()
+{
+    delete [] pcCounts;
+    delete [] targetCounts;
+    for (int i = 0; i < numSymbols; i++)
+	delete [] symbols[i].name;
+    delete [] symbols;
+}
+
+//----------------------------------------------------------------------
+// Profile::Grow
+// 	Make the count arrays big enough to count "word" (a virtual
+//	address divided by 4), at least doubling them so this is rare.
+//----------------------------------------------------------------------
+
+void
+Profile::Grow(unsigned int word)
+{
+    unsigned int size = max(word + 1, 2 * numWords);
+    int *newPcCounts = new int[size];
+    int *newTargetCounts = new int[size];
+    unsigned int i;
+
+    for (i = 0; i < size; i++) {
+	newPcCounts[i] = (i < numWords) ? pcCounts[i] : 0;
+	newTargetCounts[i] = (i < numWords) ? targetCounts[i] : 0;
+    }
+    delete [] pcCounts;
+    delete [] targetCounts;
+    pcCounts = newPcCounts;
+    targetCounts = newTargetCounts;
+    numWords = size;
+}
+
+//----------------------------------------------------------------------
+// Profile::AddSymbol
+// 	Record that procedure "name" starts at virtual address "address",
+//	so the report can say which procedure each PC is in.  Called
+//	when a program with a symbol table is loaded.
+//----------------------------------------------------------------------
+
+void
+Profile::AddSymbol(int address, char *name)
+{
+    if (numSymbols == maxSymbols) {
+	ProfileSymbol *old = symbols;
+
+	maxSymbols = max(16, 2 * maxSymbols);
+	symbols = new ProfileSymbol[maxSymbols];
+	for (int i = 0; i < numSymbols; i++)
+	    symbols[i] = old[i];
+	delete [] old;
+    }
+    symbols[numSymbols].address = address;
+    symbols[numSymbols].name = new char[strlen(name) + 1];
+    strcpy(symbols[numSymbols].name, name);
+    numSymbols++;
+    qsort(symbols, numSymbols, sizeof(ProfileSymbol), CompareSymbols);
+}
+
+//----------------------------------------------------------------------
+// Profile::FindSymbol
+// 	Return the index in "symbols" of the procedure containing
+//	"address" -- the last one starting at or before it -- or -1 if
+//	there is none.
+//----------------------------------------------------------------------
+
+int
+Profile::FindSymbol(int address)
+{
+    int low = 0, high = numSymbols - 1, found = -1;
+
+    while (low <= high) {
+	int mid = (low + high) / 2;
+
+	if (symbols[mid].address <= address) {
+	    found = mid;
+	    low = mid + 1;
+	} else
+	    high = mid - 1;
+    }
+    return found;
+}
+
+//----------------------------------------------------------------------
+// Profile::Locate
+// 	Print "address" into "buffer" as procedure+offset, or "-" if we
+//	don't know what procedure it is in.
+//----------------------------------------------------------------------
+
+void
+Profile::Locate(int address, char *buffer)
+{
+    int sym = FindSymbol(address);
+
+    if (sym < 0)
+	strcpy(buffer, "-");
+    else if (symbols[sym].address == address)
+	sprintf(buffer, "%.60s", symbols[sym].name);
+    else
+	sprintf(buffer, "%.60s+0x%x", symbols[sym].name,
+					address - symbols[sym].address);
+}
+
+//----------------------------------------------------------------------
+// Profile::Report
+// 	Write the profile to "fileName", in the format described at the
+//	top of this file.  Called when Nachos halts.
+//----------------------------------------------------------------------
+
+void
+Profile::Report()
+{
+    ProfileEntry *entries = 
+		new ProfileEntry[max(numWords, (unsigned) numSymbols + 1)];
+    int *procCounts = new int[numSymbols + 1];	// last one is "-"
+    int fd = OpenForWrite(fileName);
+    int total = 0;
+    int branches = 0;
+    int n, i;
+    unsigned int w;
+    char line[200], where[80];
+
+    for (i = 0; i <= numSymbols; i++)
+	procCounts[i] = 0;
+    for (w = 0; w < numWords; w++) {
+	int sym = FindSymbol(w * 4);
+
+	total += pcCounts[w];
+	branches += targetCounts[w];
+	procCounts[(sym < 0) ? numSymbols : sym] += pcCounts[w];
+    }
+    sprintf(line, "total %d %d\n", total, branches);
+    WriteFile(fd, line, strlen(line));
+    if (total == 0)
+	total = 1;			// avoid dividing by zero below
+
+    // procedures -- "address" is an index into symbols
+    for (i = 0, n = 0; i <= numSymbols; i++)
+	if (procCounts[i] > 0) {
+	    entries[n].address = i;
+	    entries[n++].count = procCounts[i];
+	}
+    qsort(entries, n, sizeof(ProfileEntry), CompareEntries);
+    for (i = 0; i < n; i++) {
+	int sym = entries[i].address;
+
+	sprintf(line, "proc %d %.2f %.60s\n", entries[i].count,
+		100.0 * entries[i].count / total,
+		(sym == numSymbols) ? "-" : symbols[sym].name);
+	WriteFile(fd, line, strlen(line));
+    }
+
+    // instructions
+    for (w = 0, n = 0; w < numWords; w++)
+	if (pcCounts[w] > 0) {
+	    entries[n].address = w * 4;
+	    entries[n++].count = pcCounts[w];
+	}
+    qsort(entries, n, sizeof(ProfileEntry), CompareEntries);
+    for (i = 0; i < n; i++) {
+	Locate(entries[i].address, where);
+	sprintf(line, "pc 0x%08x %d %.2f %s\n", entries[i].address,
+		entries[i].count, 100.0 * entries[i].count / total, where);
+	WriteFile(fd, line, strlen(line));
+    }
+
+    // branch targets
+    for (w = 0, n = 0; w < numWords; w++)
+	if (targetCounts[w] > 0) {
+	    entries[n].address = w * 4;
+	    entries[n++].count = targetCounts[w];
+	}
+    qsort(entries, n, sizeof(ProfileEntry), CompareEntries);
+    for (i = 0; i < n; i++) {
+	Locate(entries[i].address, where);
+	sprintf(line, "target 0x%08x %d %s\n", entries[i].address,
+		entries[i].count, where);
+	WriteFile(fd, line, strlen(line));
+    }
+
+    Close(fd);
+    delete [] entries;
+    delete [] procCounts;
+    cout << "Profile written to " << fileName << "\n";
+}
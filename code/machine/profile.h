@@ -0,0 +1,76 @@
+// profile.h
+//	Data structures for profiling user programs: how many times the
+//	instruction at each PC was executed, and how many times each
+//	address was the target of a taken branch or jump.
+//
+//	The counts are kept by the machine emulation when Nachos is run
+//	with "-prof <file>", and written to the file when Nachos halts.
+//	PCs are virtual addresses, so the counts of several user programs
+//	running at once are lumped together.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include "copyright.h"
+#include "utility.h"
+
+// A procedure in the program being profiled, from the symbol table
+// coff2noff leaves at the end of the NOFF file (see noff.h).
+
+class ProfileSymbol {
+  public:
+    int address;		// where the procedure starts
+    char *name;			// its name
+};
+
+// The following class defines the profile of the user programs that
+// have run so far.
+
+class Profile {
+  public:
+    Profile(char *fileName);	// start profiling; the report goes
+				// to the UNIX file "fileName"
+    ~Profile();			// de-allocate the counts
+
+    void CountInstruction(int pc) {	// the instruction at "pc" is
+	unsigned int word = (unsigned) pc / 4;	// being executed
+	if (word >= numWords)
+	    Grow(word);
+	pcCounts[word]++;
+    }
+    void CountBranch(int target) {	// a branch or jump to "target"
+	unsigned int word = (unsigned) target / 4;	// was taken
+	if (word >= numWords)
+	    Grow(word);
+	targetCounts[word]++;
+    }
+
+    void AddSymbol(int address, char *name);
+				// procedure "name" starts at "address"
+
+    void Report();		// write out the profile, sorted by count
+
+  private:
+    void Grow(unsigned int word);	// make room for counts up to
+				// and including "word"
+    int FindSymbol(int address);	// the procedure containing
+				// "address" (an index into symbols), or -1
+    void Locate(int address, char *buffer);
+				// print "address" as procedure+offset
+
+    char *fileName;		// where the report goes
+    unsigned int numWords;	// number of words of user address space
+				// we have counts for
+    int *pcCounts;		// times each word was executed
+    int *targetCounts;		// times each word was branched to
+
+    ProfileSymbol *symbols;	// known procedures, sorted by address
+    int numSymbols;
+    int maxSymbols;		// size of the symbols array
+};
+
+#endif // PROFILE_H
@@ -10,6 +10,7 @@
 #include "copyright.h"
 #include "debug.h"
 #include "stats.h"
+#include "machine.h"
 
 //----------------------------------------------------------------------
 // Statistics::Statistics
@@ -22,6 +23,13 @@ Statistics::Statistics()
     numDiskReads = numDiskWrites = 0;
     numConsoleCharsRead = numConsoleCharsWritten = 0;
     numPageFaults = numPacketsSent = numPacketsRecvd = 0;
+    numPageIns = numPageOuts = numFaultedAround = 0;
+    numUserPages = numPagesTouched = numZeroFills = 0;
+    numTLBHits = numTLBMisses = 0;
+    numPagesShared = numCopiesOnWrite = numTextPagesShared = 0;
+    numICacheHits = numICacheMisses = numDCacheHits = numDCacheMisses = 0;
+    for (int i = 0; i < NumSyscallCodes; i++)
+	numSyscalls[i] = syscallTicks[i] = 0;
 }
 
 //----------------------------------------------------------------------
@@ -39,7 +47,62 @@ Statistics::Print()
 		cout << ", writes " << numDiskWrites << "\n";
 		cout << "Console I/O: reads " << numConsoleCharsRead;
     cout << ", writes " << numConsoleCharsWritten << "\n";
-    cout << "Paging: faults " << numPageFaults << "\n";
+    cout << "Paging: faults " << numPageFaults;
+		cout << ", page-ins " << numPageIns;
+		cout << ", page-outs " << numPageOuts;
+		cout << ", faulted around " << numFaultedAround << "\n";
+    cout << "Memory: " << NumPhysPages << " frames of " << PageSize <<
+								" bytes\n";
+    if (numUserPages > 0)
+	cout << "Memory: pages touched " << numPagesTouched << " of " <<
+		numUserPages << ", zero-filled " << numZeroFills << "\n";
+    if (userTicks > 0)
+	cout << "Paging: faults per 1000 user ticks " << 
+				numPageFaults * 1000.0 / userTicks << "\n";
+    if (numTLBHits + numTLBMisses > 0)
+	cout << "TLB: hits " << numTLBHits << ", misses " << numTLBMisses
+								<< "\n";
+    if (numPagesShared > 0)
+	cout << "Fork: pages shared " << numPagesShared << 
+			", copied on write " << numCopiesOnWrite << "\n";
+    if (numTextPagesShared > 0)
+	cout << "Text: page faults sharing a frame " << numTextPagesShared 
+								<< "\n";
     cout << "Network I/O: packets received " << numPacketsRecvd;
 		cout << ", sent " << numPacketsSent << "\n";
+    if (numICacheHits + numICacheMisses > 0) {
+	cout << "I-cache: hits " << numICacheHits;
+		cout << ", misses " << numICacheMisses << "\n";
+	cout << "D-cache: hits " << numDCacheHits;
+		cout << ", misses " << numDCacheMisses << "\n";
+    }
+    for (int i = 0; i < NumSyscallCodes; i++) {
+	if (numSyscalls[i] == 0)
+	    continue;
+	if (SyscallName(i) != NULL)
+	    cout << "Syscall " << SyscallName(i);
+	else
+	    cout << "Syscall " << i;
+	cout << ": calls " << numSyscalls[i] << ", ticks " << 
+						syscallTicks[i] << "\n";
+    }
+}
+
+//----------------------------------------------------------------------
+// Statistics::Checkpoint, Statistics::Restore
+// 	Write the counters to, or read them back from, a checkpoint file.
+//	The class is plain data, so it is copied whole; the checkpoint
+//	header guards against reading one written by a different build.
+//----------------------------------------------------------------------
+
+void
+Statistics::Checkpoint(int fd)
+{
+    WriteFile(fd, (char *) this, sizeof(Statistics));
+}
+
+void
+Statistics::Restore(int fd)
+{
+    Read(fd, (char *) this, sizeof(Statistics));
 }
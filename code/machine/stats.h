@@ -19,6 +19,19 @@
 //
 // The fields in this class are public to make it easier to update.
 // 2015/12/02 : change timerticks from 100 to 500
+// 2026/10/17 : count system calls, and the time spent in each kind
+// 2026/10/17 : count I-cache and D-cache hits and misses (-cache)
+// 2026/10/17 : count pages read in and written out by demand paging
+// 2026/10/17 : print the page fault rate, to compare policies (-pr)
+// 2026/10/17 : count TLB hits and misses (-tlb)
+// 2026/10/17 : count pages shared by Fork, and copied on write
+// 2026/10/17 : count text pages shared between programs
+// 2026/10/17 : count user pages touched, and those zero-filled
+// 2026/10/17 : print the size of physical memory, now set at boot
+// 2026/10/17 : count pages brought in around a page fault
+
+const int NumSyscallCodes = 128;	// system call codes we keep counts
+					// for (see userprog/syscall.h)
 
 class Statistics {
   public:
@@ -27,19 +40,46 @@ class Statistics {
     int systemTicks;	 	// Time spent executing system code
     int userTicks;       	// Time spent executing user code
 				// (this is also equal to # of
-				// user instructions executed)
+				// user instructions executed, plus
+				// any cache stalls)
 
     int numDiskReads;		// number of disk read requests
     int numDiskWrites;		// number of disk write requests
     int numConsoleCharsRead;	// number of characters read from the keyboard
     int numConsoleCharsWritten; // number of characters written to the display
     int numPageFaults;		// number of virtual memory page faults
+    int numPageIns;		// pages read from swap or an executable
+    int numPageOuts;		// pages written out to swap
+    int numFaultedAround;	// pages brought in after the one faulted
+				// on, in case they are used next
+    int numUserPages;		// pages in the address spaces created
+    int numPagesTouched;	// of those, pages ever used
+    int numZeroFills;		// pages brought in by zeroing a frame
+				// (stack and uninitialized data)
+    int numTLBHits;		// translations found in the TLB
+    int numTLBMisses;		// and not found, so refilled by the kernel
+    int numPagesShared;		// pages a forked child shares with its parent
+    int numCopiesOnWrite;	// shared pages copied when written
+    int numTextPagesShared;	// page faults on text pages that found
+				// them in memory already
     int numPacketsSent;		// number of packets sent over the network
     int numPacketsRecvd;	// number of packets received over the network
+    int numICacheHits;		// instruction fetches that hit the I-cache
+    int numICacheMisses;	// and that missed (with -cache)
+    int numDCacheHits;		// loads and stores that hit the D-cache
+    int numDCacheMisses;	// and that missed
+
+    int numSyscalls[NumSyscallCodes];	// number of system calls of
+				// each kind, indexed by code
+    int syscallTicks[NumSyscallCodes];	// time from the start of each
+				// kind of system call to its return
 
     Statistics(); 		// initialize everything to zero
 
     void Print();		// print collected statistics
+
+    void Checkpoint(int fd);	// save/restore the counters to/from
+    void Restore(int fd);	// the UNIX file "fd" (see Kernel::Checkpoint)
 };
 
 // Constants used to reflect the relative time an operation would
@@ -73,7 +73,7 @@ Timer::SetInterrupt()
        int delay = TimerTicks;
     
        if (randomize) {
-	     delay = 1 + (RandomNumber() % (TimerTicks * 2));
+	     delay = 1 + (kernel->eventLog->Random() % (TimerTicks * 2));
         }
        // schedule the next timer device interrupt
        kernel->interrupt->Schedule(this, delay, TimerInt);
@@ -6,13 +6,16 @@
 //
 // Two types of translation are supported here.
 //
-//	Linear page table -- the virtual page # is used as an index
-//	into the table, to find the physical page #.
+//	Page table -- the virtual page # is looked up in the table
+//	(linear, two-level, or inverted: see pagetable.h), to find the
+//	physical page #.
 //
 //	Translation lookaside buffer -- associative lookup in the table
 //	to find an entry with the same virtual page #.  If found,
 //	this entry is used for the translation.
 //	If not, it traps to software with an exception. 
+//	The lookup is only in the set of entries that can hold the
+//	page, and each entry carries the ID of its address space.
 //
 //	In practice, the TLB is much smaller than the amount of physical
 //	memory (16 entries is common on a machine that has 1000's of
@@ -21,7 +24,8 @@
 //	anything at all about that.
 //
 //	Note that the contents of the TLB are specific to an address space.
-//	If the address space changes, so does the contents of the TLB!
+//	Entries are tagged with an address-space ID, so entries of other
+//	address spaces can stay in the TLB; they just don't match.
 //
 // DO NOT CHANGE -- part of the machine emulation
 //
@@ -70,10 +74,39 @@ ShortToMachine(unsigned short shortword) { return ShortToHost(shortword); }
 
 
 //----------------------------------------------------------------------
-// Machine::ReadMem
+// Machine::ReadMem, Machine::WriteMem
+// 	The versions of ReadMemory and WriteMemory for the kernel to call:
+//	with the debugging messages compiled in only if they might be
+//	printed.
+//----------------------------------------------------------------------
+
+bool
+Machine::ReadMem(int addr, int size, int *value)
+{
+    if (traceEnabled)
+	return ReadMemory<TRUE>(addr, size, value);
+    return ReadMemory<FALSE>(addr, size, value);
+}
+
+bool
+Machine::WriteMem(int addr, int size, int value)
+{
+    if (traceEnabled)
+	return WriteMemory<TRUE>(addr, size, value);
+    return WriteMemory<FALSE>(addr, size, value);
+}
+
+//----------------------------------------------------------------------
+// Machine::ReadMemory
 //      Read "size" (1, 2, or 4) bytes of virtual memory at "addr" into 
 //	the location pointed to by "value".
 //
+//	A read from a page that was translated recently is done straight
+//	from the host memory cached for it in readCache.  Otherwise the
+//	address is translated as usual (checking alignment and setting 
+//	the use bit), and the result is cached.  If we are modeling the
+//	caches, the access goes through the D-cache.
+//
 //   	Returns FALSE if the translation step from virtual to physical memory
 //   	failed.
 //
@@ -82,48 +115,64 @@ ShortToMachine(unsigned short shortword) { return ShortToHost(shortword); }
 //	"value" -- the place to write the result
 //----------------------------------------------------------------------
 
-bool
-Machine::ReadMem(int addr, int size, int *value)
+template <bool tracing> bool
+Machine::ReadMemory(int addr, int size, int *value)
 {
     int data;
     ExceptionType exception;
     int physicalAddress;
+    unsigned int vpn = (unsigned) addr / PageSize;
+    HostTranslation *cached = &readCache[vpn % HostCacheSize];
+    char *hostAddress;
     
-    DEBUG(dbgAddr, "Reading VA " << addr << ", size " << size);
+    TRACE(dbgAddr, "Reading VA " << addr << ", size " << size);
     
-    exception = Translate(addr, &physicalAddress, size, FALSE);
-    if (exception != NoException) {
-	RaiseException(exception, addr);
-	return FALSE;
+    if ((cached->virtualPage == vpn) && !(addr & (size - 1)))
+	hostAddress = cached->host + (unsigned) addr % PageSize;
+    else {
+	exception = Translate<tracing>(addr, &physicalAddress, size, FALSE);
+	if (exception != NoException) {
+	    RaiseException(exception, addr);
+	    return FALSE;
+	}
+	hostAddress = &mainMemory[physicalAddress];
+	if (!tracing)
+	    CacheTranslation(cached, vpn, physicalAddress / PageSize);
     }
+    if (dcache != NULL)
+	CacheAccess(dcache, hostAddress - mainMemory);
     switch (size) {
       case 1:
-	data = mainMemory[physicalAddress];
+	data = *hostAddress;
 	*value = data;
 	break;
 	
       case 2:
-	data = *(unsigned short *) &mainMemory[physicalAddress];
+	data = *(unsigned short *) hostAddress;
 	*value = ShortToHost(data);
 	break;
 	
       case 4:
-	data = *(unsigned int *) &mainMemory[physicalAddress];
+	data = *(unsigned int *) hostAddress;
 	*value = WordToHost(data);
 	break;
 
       default: ASSERT(FALSE);
     }
     
-    DEBUG(dbgAddr, "\tvalue read = " << *value);
+    TRACE(dbgAddr, "\tvalue read = " << *value);
     return (TRUE);
 }
 
 //----------------------------------------------------------------------
-// Machine::WriteMem
+// Machine::WriteMemory
 //      Write "size" (1, 2, or 4) bytes of the contents of "value" into
 //	virtual memory at location "addr".
 //
+//	As with ReadMemory, recent translations are cached, in writeCache;
+//	since a page only gets in there by way of Translate, its dirty 
+//	bit is already set by the time we skip Translate for it.
+//
 //   	Returns FALSE if the translation step from virtual to physical memory
 //   	failed.
 //
@@ -132,40 +181,96 @@ Machine::ReadMem(int addr, int size, int *value)
 //	"value" -- the data to be written
 //----------------------------------------------------------------------
 
-bool
-Machine::WriteMem(int addr, int size, int value)
+template <bool tracing> bool
+Machine::WriteMemory(int addr, int size, int value)
 {
     ExceptionType exception;
     int physicalAddress;
+    unsigned int vpn = (unsigned) addr / PageSize;
+    HostTranslation *cached = &writeCache[vpn % HostCacheSize];
+    char *hostAddress;
+    int pageFrame;
      
-    DEBUG(dbgAddr, "Writing VA " << addr << ", size " << size << ", value " << value);
+    TRACE(dbgAddr, "Writing VA " << addr << ", size " << size << ", value " << value);
 
-    exception = Translate(addr, &physicalAddress, size, TRUE);
-    if (exception != NoException) {
-	RaiseException(exception, addr);
-	return FALSE;
+    if ((cached->virtualPage == vpn) && !(addr & (size - 1))) {
+	hostAddress = cached->host + (unsigned) addr % PageSize;
+	pageFrame = cached->physicalPage;
+    } else {
+	exception = Translate<tracing>(addr, &physicalAddress, size, TRUE);
+	if (exception != NoException) {
+	    RaiseException(exception, addr);
+	    return FALSE;
+	}
+	hostAddress = &mainMemory[physicalAddress];
+	pageFrame = physicalAddress / PageSize;
+	if (!tracing)
+	    CacheTranslation(cached, vpn, pageFrame);
     }
+    if (dcache != NULL)
+	CacheAccess(dcache, hostAddress - mainMemory);
     switch (size) {
       case 1:
-	mainMemory[physicalAddress] = (unsigned char) (value & 0xff);
+	*hostAddress = (unsigned char) (value & 0xff);
 	break;
 
       case 2:
-	*(unsigned short *) &mainMemory[physicalAddress]
+	*(unsigned short *) hostAddress
 		= ShortToMachine((unsigned short) (value & 0xffff));
 	break;
       
       case 4:
-	*(unsigned int *) &mainMemory[physicalAddress]
+	*(unsigned int *) hostAddress
 		= WordToMachine((unsigned int) value);
 	break;
 	
       default: ASSERT(FALSE);
     }
+    pageDecoded[pageFrame] = FALSE;	// may be code
     
     return TRUE;
 }
 
+//----------------------------------------------------------------------
+// Machine::CacheTranslation
+// 	Remember that virtual page "vpn" was just translated to physical
+//	page "pageFrame", in the cache entry "cached".  
+//
+//	Nothing is cached while address debugging is on, so that every
+//	access is still traced through Translate.
+//----------------------------------------------------------------------
+
+void
+Machine::CacheTranslation(HostTranslation *cached, unsigned int vpn, 
+								int pageFrame)
+{
+    if (debug->IsEnabled(dbgAddr))
+	return;
+    cached->virtualPage = vpn;
+    cached->physicalPage = pageFrame;
+    cached->host = &mainMemory[pageFrame * PageSize];
+}
+
+//----------------------------------------------------------------------
+// Machine::FlushTranslations
+// 	Empty the caches of recent translations, because the page table 
+//	or TLB may have changed (or to make sure the next access to each
+//	page sets its use and dirty bits again).
+//
+//	Called on every context switch, and after handling every 
+//	exception, as well as by the kernel whenever it changes a 
+//	translation on its own.
+//----------------------------------------------------------------------
+
+void
+Machine::FlushTranslations()
+{
+    for (int i = 0; i < HostCacheSize; i++) {
+	readCache[i].virtualPage = NoHostTranslation;
+	writeCache[i].virtualPage = NoHostTranslation;
+    }
+}
+
 //----------------------------------------------------------------------
 // Machine::Translate
 // 	Translate a virtual address into a physical address, using 
@@ -181,7 +286,7 @@ Machine::WriteMem(int addr, int size, int value)
 // 	"writing" -- if TRUE, check the "read-only" bit in the TLB
 //----------------------------------------------------------------------
 
-ExceptionType
+template <bool tracing> ExceptionType
 Machine::Translate(int virtAddr, int* physAddr, int size, bool writing)
 {
     int i;
@@ -189,11 +294,11 @@ Machine::Translate(int virtAddr, int* physAddr, int size, bool writing)
     TranslationEntry *entry;
     unsigned int pageFrame;
 
-    DEBUG(dbgAddr, "\tTranslate " << virtAddr << (writing ? " , write" : " , read"));
+    TRACE(dbgAddr, "\tTranslate " << virtAddr << (writing ? " , write" : " , read"));
 
 // check for alignment errors
     if (((size == 4) && (virtAddr & 0x3)) || ((size == 2) && (virtAddr & 0x1))){
-	DEBUG(dbgAddr, "Alignment problem at " << virtAddr << ", size " << size);
+	TRACE(dbgAddr, "Alignment problem at " << virtAddr << ", size " << size);
 	return AddressErrorException;
     }
     // we must have either a TLB or a page table, but not both!
@@ -205,39 +310,45 @@ Machine::Translate(int virtAddr, int* physAddr, int size, bool writing)
     vpn = (unsigned) virtAddr / PageSize;
     offset = (unsigned) virtAddr % PageSize;
     
-    if (tlb == NULL) {		// => page table => vpn is index into table
-	if (vpn >= pageTableSize) {
-	    DEBUG(dbgAddr, "Illegal virtual page # " << virtAddr);
+    if (tlb == NULL) {		// => page table => walk it
+	if (vpn >= (unsigned) pageTable->NumPages()) {
+	    TRACE(dbgAddr, "Illegal virtual page # " << virtAddr);
 	    return AddressErrorException;
-	} else if (!pageTable[vpn].valid) {
-	    DEBUG(dbgAddr, "Invalid virtual page # " << virtAddr);
+	}
+	entry = pageTable->Lookup(vpn);
+	if (entry == NULL) {
+	    TRACE(dbgAddr, "Invalid virtual page # " << virtAddr);
 	    return PageFaultException;
 	}
-	entry = &pageTable[vpn];
-    } else {
-        for (entry = NULL, i = 0; i < TLBSize; i++)
-    	    if (tlb[i].valid && (tlb[i].virtualPage == ((int)vpn))) {
+    } else {			// => TLB => search vpn's set
+	int first = TLBSet(vpn);
+
+        for (entry = NULL, i = first; i < first + tlbWays; i++)
+    	    if (tlb[i].valid && (tlb[i].virtualPage == ((int)vpn)) &&
+					(tlbAsid[i] == currentAsid)) {
 		entry = &tlb[i];			// FOUND!
 		break;
 	    }
 	if (entry == NULL) {				// not found
-    	    DEBUG(dbgAddr, "Invalid TLB entry for this virtual page!");
+    	    TRACE(dbgAddr, "Invalid TLB entry for this virtual page!");
+	    kernel->stats->numTLBMisses++;
     	    return PageFaultException;		// really, this is a TLB fault,
 						// the page may be in memory,
 						// but not in the TLB
 	}
+	kernel->stats->numTLBHits++;
     }
 
     if (entry->readOnly && writing) {	// trying to write to a read-only page
-	DEBUG(dbgAddr, "Write to read-only page at " << virtAddr);
+	TRACE(dbgAddr, "Write to read-only page at " << virtAddr);
 	return ReadOnlyException;
     }
     pageFrame = entry->physicalPage;
 
     // if the pageFrame is too big, there is something really wrong! 
     // An invalid translation was loaded into the page table or TLB. 
-    if (pageFrame >= NumPhysPages) { 
-	DEBUG(dbgAddr, "Illegal pageframe " << pageFrame);
+    if (pageFrame >= (unsigned) NumPhysPages) { 
+	TRACE(dbgAddr, "Illegal pageframe " << pageFrame);
 	return BusErrorException;
     }
     entry->use = TRUE;		// set the use, dirty bits
@@ -245,6 +356,17 @@ Machine::Translate(int virtAddr, int* physAddr, int size, bool writing)
 	entry->dirty = TRUE;
     *physAddr = pageFrame * PageSize + offset;
     ASSERT((*physAddr >= 0) && ((*physAddr + size) <= MemorySize));
-    DEBUG(dbgAddr, "phys addr = " << *physAddr);
+    TRACE(dbgAddr, "phys addr = " << *physAddr);
     return NoException;
 }
+
+// The versions of the templates used elsewhere (in mipssim.cc)
+
+template bool Machine::ReadMemory<TRUE>(int addr, int size, int *value);
+template bool Machine::ReadMemory<FALSE>(int addr, int size, int *value);
+template bool Machine::WriteMemory<TRUE>(int addr, int size, int value);
+template bool Machine::WriteMemory<FALSE>(int addr, int size, int value);
+template ExceptionType Machine::Translate<TRUE>(int virtAddr, int* physAddr,
+						int size, bool writing);
+template ExceptionType Machine::Translate<FALSE>(int virtAddr, int* physAddr,
+						int size, bool writing);
@@ -42,4 +42,21 @@ class TranslationEntry {
 			// page is modified.
 };
 
+// The following class defines an entry in the machine's cache of recent
+// translations (see Machine::ReadMem).  Each entry maps one virtual page
+// straight to where that page is kept in the host's memory, so that a
+// load or store that hits in the cache doesn't need to look at the page
+// table or TLB at all.
+
+class HostTranslation {
+  public:
+    unsigned int virtualPage;	// The page number in virtual memory, or
+				// NoHostTranslation if the entry is empty
+    int physicalPage;		// The page number in real memory
+    char *host;			// Where physical page "physicalPage"
+				// starts, in the host's memory
+};
+
+const unsigned int NoHostTranslation = (unsigned int) -1;
+
 #endif
@@ -0,0 +1,31 @@
+/* ckpt.c
+ *	Simple program to test checkpoint and restore.
+ *
+ *	Run it once to take the checkpoint:
+ *		nachos -ckpt ckpt.img -e ../test/ckpt
+ *	which prints 0 (the checkpoint was taken) and the sum, 85344;
+ *	then carry on from the checkpoint:
+ *		nachos -restore ckpt.img
+ *	which prints 1 (carrying on) and the same sum, computed from the
+ *	data set up before the checkpoint.
+ */
+
+#include "syscall.h"
+
+int
+main()
+{
+    int data[64];
+    int i, sum = 0, result;
+
+    for (i = 0; i < 64; i++)
+	data[i] = i * i;
+    result = Checkpoint();
+    if (result < 0)
+	MSG("Failed on taking the checkpoint");
+    for (i = 0; i < 64; i++)
+	sum += data[i];
+    PrintInt(result);
+    PrintInt(sum);
+    Halt();
+}
@@ -14,6 +14,22 @@
 // 2015/10/28: in Exec: now theard call AddrSpace(int threadNum) to initialize
 // 2015/10/28: in Exec: now change back to call AddrSpace to initialize for dynamically alloc
 // 2015/12/02: add -ep argv, and modify Exec to take priority as arg
+// 2026/10/17: add -bb argv, to run user programs with the basic-block engine
+// 2026/10/17: add -cb argv, to also compile hot basic blocks
+// 2026/10/17: add -prof argv, to profile user programs
+// 2026/10/17: add -ckpt and -restore argv, and Checkpoint()/Restore()
+// 2026/10/17: add -record and -replay argv, to log external events
+// 2026/10/17: add -cache argv, to model the I-cache and D-cache
+// 2026/10/17: create the frame table and swap area, for demand paging
+// 2026/10/17: add -pr argv, to choose the page replacement policy
+// 2026/10/17: add -tlb argv, to translate through a software-loaded TLB
+// 2026/10/17: add -pt argv, to choose linear, two-level or inverted
+//             page tables
+// 2026/10/17: add Fork(), for the Fork syscall
+// 2026/10/17: add -mem, -page and -mmap argv, to choose the size of
+//             physical memory and of a page when booting
+// 2026/10/17: Checkpoint() refuses while another user program exists, or
+//             if the checkpoint file can't be written
 // end Record ----------------------------------------------------
 
 #include "copyright.h"
@@ -28,6 +44,9 @@
 #include "synchdisk.h"
 #include "post.h"
 #include "synchconsole.h"
+#include "frametable.h"
+#include "swap.h"
+#include "tlbmanager.h"
 
 //----------------------------------------------------------------------
 // Kernel::Kernel
@@ -39,11 +58,27 @@ Kernel::Kernel(int argc, char **argv)
 {
     randomSlice = FALSE; 
     debugUserProg = FALSE;
+    userEngine = InterpretEngine;
+    profileFile = NULL;
+    checkpointFile = NULL;
+    restoreFile = NULL;
+    eventLogMode = LogOff;
+    eventLogFile = NULL;
+    cacheSize = 0;              // no caches
+    replacementKind = FifoReplacement;
+#ifdef USE_TLB
+    tlbSize = tlbWays = TLBSize;    // a small, fully associative TLB
+#else
+    tlbSize = tlbWays = 0;      // page tables
+#endif
+    pageTableKind = LinearPageTable;
+    pageTableChosen = FALSE;
     consoleIn = NULL;          // default is stdin
     consoleOut = NULL;         // default is stdout
 #ifndef FILESYS_STUB
     formatFlag = FALSE;
 #endif
+    mapMemory = FALSE;
     reliability = 1;            // network reliability, default is 1.0
     hostName = 0;               // machine id, also UNIX socket name
                                 // 0 is the default machine id
@@ -56,6 +91,84 @@ Kernel::Kernel(int argc, char **argv)
 	    	i++;
         } else if (strcmp(argv[i], "-s") == 0) {
             debugUserProg = TRUE;
+        } else if (strcmp(argv[i], "-bb") == 0) {
+            userEngine = BlockEngine;
+        } else if (strcmp(argv[i], "-cb") == 0) {
+            userEngine = CompileEngine;
+        } else if (strcmp(argv[i], "-prof") == 0) {
+            ASSERT(i + 1 < argc);
+            profileFile = argv[i + 1];
+            i++;
+        } else if (strcmp(argv[i], "-ckpt") == 0) {
+            ASSERT(i + 1 < argc);
+            checkpointFile = argv[i + 1];
+            i++;
+        } else if (strcmp(argv[i], "-restore") == 0) {
+            ASSERT(i + 1 < argc);
+            restoreFile = argv[i + 1];
+            i++;
+        } else if (strcmp(argv[i], "-record") == 0) {
+            ASSERT(i + 1 < argc);
+            eventLogMode = LogRecord;
+            eventLogFile = argv[i + 1];
+            i++;
+        } else if (strcmp(argv[i], "-replay") == 0) {
+            ASSERT(i + 1 < argc);
+            eventLogMode = LogReplay;
+            eventLogFile = argv[i + 1];
+            i++;
+        } else if (strcmp(argv[i], "-cache") == 0) {
+            ASSERT(i + 4 < argc);
+            cacheSize = atoi(argv[i + 1]);
+            cacheLineSize = atoi(argv[i + 2]);
+            cacheWays = atoi(argv[i + 3]);
+            cacheMissPenalty = atoi(argv[i + 4]);
+            i += 4;
+        } else if (strcmp(argv[i], "-pr") == 0) {
+            ASSERT(i + 1 < argc);
+            if (strcmp(argv[i + 1], "fifo") == 0)
+                replacementKind = FifoReplacement;
+            else if (strcmp(argv[i + 1], "clock") == 0)
+                replacementKind = ClockReplacement;
+            else if (strcmp(argv[i + 1], "lru") == 0)
+                replacementKind = AgingReplacement;
+            else if (strcmp(argv[i + 1], "wsclock") == 0)
+                replacementKind = WSClockReplacement;
+            else {
+                cerr << "Unknown page replacement policy " << argv[i + 1]
+                                                                << "\n";
+                Abort();
+            }
+            i++;
+        } else if (strcmp(argv[i], "-tlb") == 0) {
+            ASSERT(i + 2 < argc);
+            tlbSize = atoi(argv[i + 1]);
+            tlbWays = atoi(argv[i + 2]);
+            i += 2;
+        } else if (strcmp(argv[i], "-pt") == 0) {
+            ASSERT(i + 1 < argc);
+            if (strcmp(argv[i + 1], "linear") == 0)
+                pageTableKind = LinearPageTable;
+            else if (strcmp(argv[i + 1], "2level") == 0)
+                pageTableKind = TwoLevelPageTable;
+            else if (strcmp(argv[i + 1], "inverted") == 0)
+                pageTableKind = InvertedPageTable;
+            else {
+                cerr << "Unknown page table kind " << argv[i + 1] << "\n";
+                Abort();
+            }
+            pageTableChosen = TRUE;
+            i++;
+        } else if (strcmp(argv[i], "-mem") == 0) {
+            ASSERT(i + 1 < argc);
+            NumPhysPages = atoi(argv[i + 1]);
+            i++;
+        } else if (strcmp(argv[i], "-page") == 0) {
+            ASSERT(i + 1 < argc);
+            PageSize = atoi(argv[i + 1]);
+            i++;
+        } else if (strcmp(argv[i], "-mmap") == 0) {
+            mapMemory = TRUE;
 		} else if (strcmp(argv[i], "-e") == 0) {
         	execfile[++execfileNum]= argv[++i];
             execpriority[execfileNum] = 0;
@@ -85,7 +198,14 @@ Kernel::Kernel(int argc, char **argv)
             i++;
         } else if (strcmp(argv[i], "-u") == 0) {
             cout << "Partial usage: nachos [-rs randomSeed]\n";
-	   		cout << "Partial usage: nachos [-s]\n";
+	   		cout << "Partial usage: nachos [-s] [-bb] [-cb] [-prof profileFile]\n";
+	   		cout << "Partial usage: nachos [-ckpt file] [-restore file]\n";
+	   		cout << "Partial usage: nachos [-record file] [-replay file]\n";
+	   		cout << "Partial usage: nachos [-cache size lineSize ways missPenalty]\n";
+	   		cout << "Partial usage: nachos [-pr fifo|clock|lru|wsclock]\n";
+	   		cout << "Partial usage: nachos [-tlb size ways]\n";
+	   		cout << "Partial usage: nachos [-pt linear|2level|inverted]\n";
+	   		cout << "Partial usage: nachos [-mem numPages] [-page pageSize] [-mmap]\n";
             cout << "Partial usage: nachos [-ci consoleIn] [-co consoleOut]\n";
 #ifndef FILESYS_STUB
 	    	cout << "Partial usage: nachos [-nf]\n";
@@ -93,6 +213,15 @@ Kernel::Kernel(int argc, char **argv)
             cout << "Partial usage: nachos [-n #] [-m #]\n";
 		}
     }
+    // pages are paged out a disk sector at a time
+    if ((NumPhysPages <= 0) || (PageSize <= 0) || (PageSize % SectorSize != 0)
+			|| (NumPhysPages > (1 << 30) / PageSize)) {
+        cerr << "Bad memory size: " << NumPhysPages << " pages of " << 
+                PageSize << " bytes (a page must be a multiple of " << 
+                SectorSize << " bytes)\n";
+        Abort();
+    }
+    MemorySize = NumPhysPages * PageSize;
     //ThreadSelfTest();
 }
 
@@ -117,9 +246,21 @@ Kernel::Initialize()
     threadNum += 2;
     stats = new Statistics();		// collect statistics
     interrupt = new Interrupt;		// start up interrupt handling
+    eventLog = new EventLog(eventLogMode, eventLogFile);
+					// before any device asks for input
     scheduler = new Scheduler();	// initialize the ready queue
     alarm = new Alarm(randomSlice);	// start up time slicing
-    machine = new Machine(debugUserProg);
+    machine = new Machine(debugUserProg, userEngine, profileFile, mapMemory);
+    if (cacheSize > 0)
+	machine->EnableCaches(cacheSize, cacheLineSize, cacheWays,
+						cacheMissPenalty);
+    if (pageTableChosen)
+	machine->UsePageTables(pageTableKind);
+    if (tlbSize > 0) {
+	machine->EnableTLB(tlbSize, tlbWays);
+	tlbManager = new TLBManager();
+    } else
+	tlbManager = NULL;
     synchConsoleIn = new SynchConsoleInput(consoleIn); // input from stdin
     synchConsoleOut = new SynchConsoleOutput(consoleOut); // output to stdout
     synchDisk = new SynchDisk();    //
@@ -128,6 +269,8 @@ Kernel::Initialize()
 #else
     fileSystem = new FileSystem(formatFlag);
 #endif // FILESYS_STUB
+    frameTable = new FrameTable(replacementKind);
+    swapArea = new SwapArea(synchDisk);
     postOfficeIn = new PostOfficeInput(10);
     postOfficeOut = new PostOfficeOutput(reliability);
 
@@ -150,8 +293,12 @@ Kernel::~Kernel()
     delete synchConsoleOut;
     delete synchDisk;
     delete fileSystem;
+    delete frameTable;
+    delete swapArea;
+    delete tlbManager;
     delete postOfficeIn;
     delete postOfficeOut;
+    delete eventLog;		// after the devices: write out the log
     
     Exit(0);
 }
@@ -274,8 +421,25 @@ void ForkExecute(Thread *t)
 
 }
 
+//----------------------------------------------------------------------
+// ForkResume
+// 	Start a thread restored from a checkpoint, or forked: carry on
+//	running its user program from the registers saved in it.
+//----------------------------------------------------------------------
+
+void ForkResume(Thread *t)
+{
+    t->RestoreUserState();
+    t->space->RestoreState();
+    kernel->machine->Run();
+
+    ASSERTNOTREACHED();
+}
+
 void Kernel::ExecAll()
 {
+	if (restoreFile != NULL)
+		Restore(restoreFile);
 	for (int i=1;i<=execfileNum;i++) {
 		int a = Exec(execfile[i], execpriority[i]);
 	}
@@ -323,6 +487,162 @@ int Kernel::Exec(char* name, int priority)
 //  cout << "after ThreadedKernel:Run();" << endl;  // unreachable
 }
 
+//----------------------------------------------------------------------
+// Kernel::Fork
+// 	Start a child of the current thread, running a copy of its user
+//	program (see AddrSpace::Fork) from the same registers -- the PC is
+//	already past the system call -- except that Fork returns 0 to it.
+//	Return the child's ID, or -1 if there is no room for another thread.
+//----------------------------------------------------------------------
+
+int
+Kernel::Fork()
+{
+    Thread *child;
+
+    if (threadNum >= (int) (sizeof(t) / sizeof(t[0])))
+	return -1;
+    child = new Thread(currentThread->getName(), threadNum, 
+					currentThread->getPriority());
+    child->space = currentThread->space->Fork(currentThread->getName());
+    machine->WriteRegister(2, 0);	// our own r2 is set on return
+    child->SaveUserState();
+    t[threadNum] = child;
+    threadNum++;
+    child->Fork((VoidFunctionPtr) &ForkResume, (void *) child);
+    return threadNum - 1;
+}
+
+// Checkpoint file header: a magic number, then the sizes of things
+// that must match for the rest of the file to make sense.
+
+const int CheckpointMagic = 0x4e434b50;		// "NCKP"
+const int CheckpointHeaderSize = 6;
+
+static void
+CheckpointHeader(int *header)
+{
+    header[0] = CheckpointMagic;
+    header[1] = MemorySize;
+    header[2] = NumTotalRegs;
+    header[3] = sizeof(Statistics);
+    header[4] = sizeof(TranslationEntry);
+    header[5] = PageSize;
+}
+
+//----------------------------------------------------------------------
+// Kernel::Checkpoint
+// 	Save the state of the simulation to "checkpointFile", so that a
+//	later "nachos -restore" can carry on from here without booting
+//	and loading all over again.  Called on the Checkpoint system
+//	call, after the PC has been advanced past it: the restored program
+//	sees Checkpoint() return 1, rather than the 0 returned here.
+//
+//	The file holds the Statistics, the CPU registers and mainMemory,
+//	the calling thread and its page table, when each pending interrupt
+//	is due, and the disk (with any of its pages that are paged out).
+//	Other threads can't be saved -- their kernel stacks are host
+//	memory -- so none may be ready to run, no other address space
+//	may exist (its thread may be waiting), and no disk, console or
+//	network output may be in progress.  Kernel threads that only wait
+//	for input, like the postal worker, hold nothing to save.
+//	Otherwise, or if there is no checkpointFile, or it can't be
+//	written, save nothing and return -1.
+//
+//	Open files are not saved, so programs should checkpoint before
+//	opening any.
+//----------------------------------------------------------------------
+
+int
+Kernel::Checkpoint()
+{
+    int header[CheckpointHeaderSize];
+    int length, priority, fd;
+
+    if (checkpointFile == NULL)
+	return -1;
+    if (!scheduler->IsEmpty() || (AddrSpace::NumSpaces() > 1) || 
+		interrupt->IsPending(DiskInt) || 
+		interrupt->IsPending(ConsoleWriteInt) || 
+		interrupt->IsPending(NetworkSendInt)) {
+	DEBUG(dbgSys, "Checkpoint refused: other threads are active");
+	return -1;
+    }
+    fd = OpenForWrite(checkpointFile, FALSE);
+    if (fd < 0) {
+	DEBUG(dbgSys, "Checkpoint refused: can't write " << checkpointFile);
+	return -1;
+    }
+
+    CheckpointHeader(header);
+    WriteFile(fd, (char *) header, sizeof(header));
+    length = strlen(currentThread->getName());
+    priority = currentThread->getPriority();
+    WriteFile(fd, (char *) &length, sizeof(int));
+    WriteFile(fd, currentThread->getName(), length);
+    WriteFile(fd, (char *) &priority, sizeof(int));
+
+    stats->Checkpoint(fd);
+    machine->WriteRegister(2, 1);	// what the restored copy sees
+    machine->Checkpoint(fd);
+    currentThread->space->Checkpoint(fd);
+    interrupt->Checkpoint(fd);
+    synchDisk->Checkpoint(fd);
+    Close(fd);
+
+    DEBUG(dbgSys, "Checkpoint written to " << checkpointFile);
+    return 0;
+}
+
+//----------------------------------------------------------------------
+// Kernel::Restore
+// 	Carry on from the checkpoint in "fileName" (see Kernel::Checkpoint),
+//	by forking a thread that resumes the saved user program.
+//----------------------------------------------------------------------
+
+void
+Kernel::Restore(char *fileName)
+{
+    int fd = OpenForReadWrite(fileName, FALSE);
+    int header[CheckpointHeaderSize], expected[CheckpointHeaderSize];
+    int length, priority;
+    int ticksBefore = stats->totalTicks;
+    char *name;
+    Thread *thread;
+
+    if (fd < 0) {
+	cerr << "Unable to open checkpoint " << fileName << "\n";
+	return;
+    }
+    CheckpointHeader(expected);
+    Read(fd, (char *) header, sizeof(header));
+    if (memcmp(header, expected, sizeof(header)) != 0) {
+	cerr << fileName << " is not a checkpoint from this Nachos\n";
+	Close(fd);
+	return;
+    }
+    Read(fd, (char *) &length, sizeof(int));
+    name = new char[length + 1];
+    Read(fd, name, length);
+    name[length] = '\0';
+    Read(fd, (char *) &priority, sizeof(int));
+
+    stats->Restore(fd);
+    machine->Restore(fd);
+    thread = new Thread(name, threadNum, priority);
+    thread->space = new AddrSpace();
+    thread->space->Restore(fd, name);
+    thread->SaveUserState();		// the registers just restored
+    interrupt->Restore(fd, ticksBefore);
+    synchDisk->Restore(fd);
+    Close(fd);
+
+    DEBUG(dbgSys, "Restored " << name << " from " << fileName);
+    t[threadNum] = thread;
+    threadNum++;
+    thread->Fork((VoidFunctionPtr) &ForkResume, (void *) thread);
+}
+
 void Kernel::PrintInt(int number) 
 {
     kernel->synchConsoleOut->PrintInt(number);
@@ -12,6 +12,16 @@
 // 2015/10/4 : define ReadFromFileId(char *buffer, int size, OpenFileId id) 
 // 2015/10/13: modify PrintInt flow again
 // 2015/12/02: modify Exec to take priority as arg
+// 2026/10/17: add blockUserProg (-bb)
+// 2026/10/17: replace blockUserProg with userEngine (-bb, -cb)
+// 2026/10/17: add profileFile (-prof)
+// 2026/10/17: add Checkpoint() and Restore() (-ckpt, -restore)
+// 2026/10/17: add eventLog (-record, -replay)
+// 2026/10/17: add the shape of the caches to model (-cache)
+// 2026/10/17: add frameTable and swapArea, for demand paging
+// 2026/10/17: add the page replacement policy to use (-pr)
+// 2026/10/17: add tlbManager, and the shape of the TLB (-tlb)
+// 2026/10/17: add the kind of page table to use (-pt)
 // end Record ----------------------------------------------------
 
 #ifndef KERNEL_H
@@ -27,12 +37,17 @@
 #include "alarm.h"
 #include "filesys.h"
 #include "machine.h"
+#include "eventlog.h"
+#include "replace.h"
 
 class PostOfficeInput;
 class PostOfficeOutput;
 class SynchConsoleInput;
 class SynchConsoleOutput;
 class SynchDisk;
+class FrameTable;
+class SwapArea;
+class TLBManager;
 
 
 
@@ -47,6 +62,11 @@ class Kernel {
 				// refers to "kernel" as a global
 	void ExecAll();
 	int Exec(char* name, int priority);
+    int Fork();			// start a copy of the current thread's
+				// user program
+    int Checkpoint();		// save the simulation to checkpointFile
+    void Restore(char *fileName);
+				// carry on from a checkpoint
     void ThreadSelfTest();	// self test of threads and synchronization
 	
     void ConsoleTest();         // interactive console self test
@@ -71,8 +91,13 @@ class Kernel {
     SynchConsoleOutput *synchConsoleOut;
     SynchDisk *synchDisk;
     FileSystem *fileSystem;     
+    FrameTable *frameTable;	// who has each page frame
+    SwapArea *swapArea;		// where pages are paged out to
+    TLBManager *tlbManager;	// who is in the TLB (NULL if there is
+				// no TLB)
     PostOfficeInput *postOfficeIn;
     PostOfficeOutput *postOfficeOut;
+    EventLog *eventLog;		// where external events come from
 
     int hostName;               // machine identifier
     void PrintInt(int number);
@@ -84,7 +109,29 @@ class Kernel {
 	int execfileNum;
 	int threadNum;
     bool randomSlice;		// enable pseudo-random time slicing
+    bool mapMemory;		// get mainMemory from a host mapping
     bool debugUserProg;         // single step user program
+    ExecEngine userEngine;      // how to run user programs: see
+                                // machine.h
+    char *profileFile;          // file to write the user program
+                                // profile to (NULL if not profiling)
+    char *checkpointFile;       // file the Checkpoint syscall writes to
+    char *restoreFile;          // checkpoint to start from, if any
+    EventLogMode eventLogMode;  // record or replay external events?
+    char *eventLogFile;         // and where to
+    int cacheSize;              // bytes in each of the I-cache and
+                                // D-cache (0 if not modeling them),
+    int cacheLineSize;          // in lines of this many bytes,
+    int cacheWays;              // this many lines to a set
+    int cacheMissPenalty;       // ticks the CPU stalls for on a miss
+    ReplacementKind replacementKind;
+                                // which pages to page out: see
+                                // userprog/replace.h
+    int tlbSize;                // entries in the TLB (0 to use page
+                                // tables instead),
+    int tlbWays;                // this many to a set
+    PageTableKind pageTableKind; // how to lay out page tables, if
+    bool pageTableChosen;       // chosen on the command line
     double reliability;         // likelihood messages are dropped
     char *consoleIn;            // file to read console input from
     char *consoleOut;           // file to send console output to
@@ -3,7 +3,10 @@
 //	operating system kernel.  
 //
 // Usage: nachos -d <debugflags> -rs <random seed #>
-//              -s -x <nachos file> -ci <consoleIn> -co <consoleOut>
+//              -s -bb -cb -prof <profile file> -x <nachos file> -ci <consoleIn> -co <consoleOut>
+//              -ckpt <checkpoint file> -restore <checkpoint file>
+//              -record <event log> -replay <event log>
+//              -cache <size> <line size> <ways> <miss penalty>
 //              -f -cp <unix file> <nachos file>
 //              -p <nachos file> -r <nachos file> -l -D
 //              -n <network reliability> -m <machine id>
@@ -13,6 +16,21 @@
 //    -rs causes Yield to occur at random (but repeatable) spots
 //    -z prints the copyright message
 //    -s causes user programs to be executed in single-step mode
+//    -bb runs user programs a basic block at a time, with the
+//	threaded-code engine, rather than one instruction at a time
+//    -cb is like -bb, but also compiles basic blocks once they are hot
+//    -prof counts how often each user instruction is executed, and 
+//	writes a report to the named file when Nachos halts
+//    -ckpt names the file the Checkpoint system call saves the 
+//	simulation to
+//    -restore carries on from a checkpoint, instead of starting afresh
+//    -record logs random numbers, console input and network packets, 
+//	with the time each arrived, to the named file
+//    -replay feeds a run the events logged by -record, so that it
+//	repeats the recorded run exactly
+//    -cache models an I-cache and a D-cache, each of the given size
+//	and shape (in bytes; all powers of 2), with each miss costing 
+//	the given number of ticks
 //    -x runs a user program
 //    -ci specify file for console input (stdin is the default)
 //    -co specify file for console output (stdout is the default)
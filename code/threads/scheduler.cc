@@ -178,6 +178,8 @@ Scheduler::FindNextToRun ()
 //
 //      Note: we assume the state of the previously running thread has
 //	already been changed from running to blocked or ready (depending).
+//	Its cache hits and misses (see Machine::ChargeCaches) are added
+//	to its counts.
 // Side effect:
 //	The global variable kernel->currentThread becomes nextThread.
 //
@@ -203,6 +205,7 @@ Scheduler::Run (Thread *nextThread, bool finishing)
         oldThread->SaveUserState(); 	// save the user's CPU registers
 	oldThread->space->SaveState();
     }
+    kernel->machine->ChargeCaches(&oldThread->cacheCounts);
     
     oldThread->CheckOverflow();		    // check if the old thread
 					    // had an undetected stack overflow
@@ -274,6 +277,17 @@ Scheduler::Print()
     readyList->Apply(ThreadPrint);
 }
 
+//----------------------------------------------------------------------
+// Scheduler::IsEmpty
+// 	Return TRUE if no thread is waiting to run, on any of the queues.
+//----------------------------------------------------------------------
+bool
+Scheduler::IsEmpty()
+{
+    return SJF_ReadyList->IsEmpty() && PJ_ReadyList->IsEmpty()
+                && RR_ReadyList->IsEmpty();
+}
+
 //----------------------------------------------------------------------
 // Scheduler::Aging
 // 	Check all the thread in list, if they wait more than 1500 ticks,
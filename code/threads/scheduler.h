@@ -41,6 +41,7 @@ class Scheduler {
     void CheckToBeDestroyed();// Check if thread that had been
     				// running needs to be deleted
     void Print();		// Print contents of ready list
+    bool IsEmpty();		// Is no thread waiting to run?
     void CheckAndMove(Thread* t, int oldPriority);    
     // SelfTest for scheduler is implemented in class Thread
     void UpdateBurstTime(Thread *t, int currentTime);   
@@ -17,6 +17,7 @@
 // of liability and disclaimer of warranty provisions.
 
 //  2015/12/02 : add another contructor that takes priority as arg.
+//  2026/10/17 : Finish() reports the thread's cache hits and misses.
 
 
 #include "copyright.h"
@@ -52,6 +53,8 @@ Thread::Thread(char* threadName, int threadID)
 					// of machine registers
     }
     space = NULL;
+    cacheCounts.instrHits = cacheCounts.instrMisses = 0;
+    cacheCounts.dataHits = cacheCounts.dataMisses = 0;
 }
 //----------------------------------------------------------------------
 // Thread::Thread
@@ -77,6 +80,8 @@ Thread::Thread(char* threadName, int threadID, int prior)
 					// of machine registers
     }
     space = NULL;
+    cacheCounts.instrHits = cacheCounts.instrMisses = 0;
+    cacheCounts.dataHits = cacheCounts.dataMisses = 0;
 }
 
 //----------------------------------------------------------------------
@@ -195,6 +200,12 @@ Thread::Begin ()
 //
 // 	NOTE: we disable interrupts, because Sleep() assumes interrupts
 //	are disabled.
+//
+//	If the caches are being modeled, a user program's hits and misses
+//	are printed as it finishes, as is the most memory its page table
+//	took up, if the kind of page table was chosen with -pt.  A user
+//	program's address space is deleted here, giving its frames and
+//	swap slots to the others.
 //----------------------------------------------------------------------
 
 //
@@ -204,6 +215,20 @@ Thread::Finish ()
     (void) kernel->interrupt->SetLevel(IntOff);		
     ASSERT(this == kernel->currentThread);
     DEBUG(dbgThread, "Finishing thread: " << name);
+    if (kernel->machine->ModelsCaches() && (space != NULL)) {
+	kernel->machine->ChargeCaches(&cacheCounts);
+	cout << name << ": I-cache hits " << cacheCounts.instrHits <<
+		", misses " << cacheCounts.instrMisses << "; D-cache hits " <<
+		cacheCounts.dataHits << ", misses " << cacheCounts.dataMisses
+		<< "\n";
+    }
+    if (kernel->machine->ReportsPageTables() && (space != NULL))
+	cout << name << ": page table " << space->PageTableBytes() <<
+							" bytes at most\n";
+    if (space != NULL) {
+	delete space;			// may wait for the frame table
+	space = NULL;
+    }
     Sleep(TRUE);				// invokes SWITCH
     // not reached
 }
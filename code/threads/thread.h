@@ -51,6 +51,7 @@
 // For simplicity, I just take the maximum over all architectures.
 // 2015/12/01 : Modify Fork()
 // 2015/12/02 : Add another constructor, that takes priority as initialization arg
+// 2026/10/17 : Add cacheCounts, the thread's cache hits and misses (-cache)
 
 #define MachineStateSize 75 
 
@@ -173,6 +174,8 @@ class Thread {
     void RestoreUserState();		// restore user-level register state
 
     AddrSpace *space;			// User code this thread is running.
+    CacheCounts cacheCounts;		// Hits and misses in the caches
+					// while it ran (see ChargeCaches)
 };
 
 // external function, dummy routine whose sole job is to call Thread::Print
@@ -17,15 +17,46 @@
 
 // Record --------------------------------------------------------
 // 2015/10/28 : Change AddrSpace:Load(), now will translate RDATA, initData and code to pa
+// 2026/10/17 : Load() invalidates decoded instructions of the frames it fills
+// 2026/10/17 : RestoreState() flushes the machine's cached translations
+// 2026/10/17 : Load() gives the program's symbols to the profiler, if any
+// 2026/10/17 : add Checkpoint() and Restore(), for -ckpt
+// 2026/10/17 : add UserBuffer and ReadString(), for syscall arguments
+// 2026/10/17 : Load() no longer reads the program in; pages are read in
+//              when they fault (PageIn()), and paged out to swap when
+//              memory runs short (PageOut()).  Frames come from
+//              kernel->frameTable, in place of inUsedPhyPages.
+// 2026/10/17 : with a TLB (-tlb), take an address-space ID, and load
+//              the TLB from the page table on a miss (RefillTLB())
+// 2026/10/17 : keep the translations in a PageTable of the kind chosen
+//              with -pt; remove AddrSpace(int threadNum), which
+//              claimed fixed frames behind the frame table's back
+// 2026/10/17 : add Fork(), which shares the pages in memory with the
+//              child copy-on-write, and CopyOnWrite(), which copies
+//              them when written
+// 2026/10/17 : PageIn() maps the text pages of an executable other
+//              address spaces are running to the frames they have
+// 2026/10/17 : count the pages each address space touches, and the
+//              pages of stack and uninitialized data zero-filled
+// 2026/10/17 : PageIn() brings in up to MaxFaultAround pages at once,
+//              as long as the program faults sequentially
+// 2026/10/17 : add MapFile() and UnmapFile(), for the Mmap syscall:
+//              mapped pages are read from the file, and written back
+//              to it in place of swap
+// 2026/10/17 : pages brought in by fault-around count as touched only
+//              once they are used (Touch())
 // end Record ----------------------------------------------------
 
 #include "copyright.h"
 #include "main.h"
 #include "addrspace.h"
 #include "machine.h"
+#include "profile.h"
 #include "noff.h"
+#include "frametable.h"
+#include "swap.h"
+#include "tlbmanager.h"
 
-bool AddrSpace::inUsedPhyPages[NumPhysPages] = {FALSE};
 //----------------------------------------------------------------------
 // SwapHeader
 // 	Do little endian to big endian conversion on the bytes in the 
@@ -62,6 +93,67 @@ SwapHeader (NoffHeader *noffH)
 #endif
 }
 
+//----------------------------------------------------------------------
+// LoadSymbols
+// 	If "executable" has a symbol table after its segments (see noff.h),
+//	tell the profiler where each of its procedures starts.
+//----------------------------------------------------------------------
+
+static void
+LoadSymbols(OpenFile *executable, NoffHeader *noffH)
+{
+    NoffSymbolHeader symH;
+    NoffSymbol *symbols;
+    char *names;
+    int position = sizeof(NoffHeader);
+
+    // the symbol table starts where the last segment ends
+    if (noffH->code.size > 0)
+	position = max(position, noffH->code.inFileAddr + noffH->code.size);
+    if (noffH->initData.size > 0)
+	position = max(position, 
+			noffH->initData.inFileAddr + noffH->initData.size);
+#ifdef RDATA
+    if (noffH->readonlyData.size > 0)
+	position = max(position, 
+		noffH->readonlyData.inFileAddr + noffH->readonlyData.size);
+#endif
+
+    if (executable->ReadAt((char *)&symH, sizeof(symH), position) 
+							!= sizeof(symH))
+	return;				// no symbol table
+    if (WordToHost(symH.symMagic) != NOFFSYMMAGIC)
+	return;
+    symH.numSymbols = WordToHost(symH.numSymbols);
+    symH.stringSize = WordToHost(symH.stringSize);
+    if ((symH.numSymbols <= 0) || (symH.stringSize <= 0))
+	return;
+    position += sizeof(symH);
+
+    symbols = new NoffSymbol[symH.numSymbols];
+    names = new char[symH.stringSize + 1];
+    if ((executable->ReadAt((char *)symbols, 
+		symH.numSymbols * sizeof(NoffSymbol), position) == 
+			(int) (symH.numSymbols * sizeof(NoffSymbol))) &&
+	    (executable->ReadAt(names, symH.stringSize, 
+		position + symH.numSymbols * sizeof(NoffSymbol)) == 
+			symH.stringSize)) {
+	names[symH.stringSize] = '\0';
+	for (int i = 0; i < symH.numSymbols; i++) {
+	    int name = WordToHost(symbols[i].name);
+
+	    if ((name >= 0) && (name < symH.stringSize))
+		kernel->machine->profile->AddSymbol(
+				WordToHost(symbols[i].address), names + name);
+	}
+	DEBUG(dbgAddr, "Loaded " << symH.numSymbols << " symbols");
+    }
+    delete [] symbols;
+    delete [] names;
+}
+
+int AddrSpace::numSpaces = 0;
+
 //----------------------------------------------------------------------
 // AddrSpace::AddrSpace
 // 	Create an address space to run a user program.
@@ -84,39 +176,61 @@ AddrSpace::AddrSpace()
     
     // zero out the entire address space
     bzero(kernel->machine->mainMemory, MemorySize);*/
+    pageTable = NULL;
+    numPages = 0;
+    swapSlot = NULL;
+    touched = NULL;
+    mappedBase = 0;
+    mappedPages = NULL;
+    mappings = NULL;
+    faultAround = 1;
+    nextFault = -1;
+    executable = NULL;
+    textId = -1;
+    asid = -1;
+    numSpaces++;
 }
 
 
-AddrSpace::AddrSpace(int threadNum)
-{
-    // static loading
-    basePhyPageNum = (threadNum - 1) * 32;
-    pageTable = new TranslationEntry[PageNumPerProc];
-    for(int i = 0; i < PageNumPerProc; i ++) {
-        pageTable[i].virtualPage = i;
-        pageTable[i].physicalPage = basePhyPageNum + i;
-	    pageTable[i].valid = TRUE;
-	    pageTable[i].use = FALSE;
-	    pageTable[i].dirty = FALSE;
-	    pageTable[i].readOnly = FALSE;  
-        kernel->machine->mainMemory[basePhyPageNum + i] = 0;
-    }
-}
-
-
-
 //----------------------------------------------------------------------
 // AddrSpace::~AddrSpace
-// 	Dealloate an address space.
+// 	Dealloate an address space, giving back its frames and swap
+//	slots, and writing back the files mapped.  Wait for any paging in
+//	progress first: it may be writing out one of our pages.
 //----------------------------------------------------------------------
 
 AddrSpace::~AddrSpace()
 {
+    while (mappings != NULL)
+	RemoveMapping(mappings);
     // release used pages.
-   for(int i = 0; i < numPages; i ++) {
-        AddrSpace::inUsedPhyPages[pageTable[i].physicalPage] = FALSE;
-   }
-   delete pageTable;
+    kernel->frameTable->Acquire();
+    if (asid >= 0) {
+	kernel->tlbManager->SyncAll(asid);	// for the use bits
+	kernel->tlbManager->FreeAsid(asid);
+    }
+    for (int i = 0; i < numPages; i++) {
+	TranslationEntry *entry = pageTable->Lookup(i);
+
+	if (entry != NULL) {
+	    if (entry->use)
+		Touch(i);
+	    kernel->frameTable->Free(entry->physicalPage, this);
+	}
+	if (swapSlot[i] >= 0)
+	    kernel->swapArea->Free(swapSlot[i]);
+    }
+    kernel->frameTable->Release();
+    if (touched != NULL) {
+	DEBUG(dbgAddr, "Address space touched " << numPages - 
+		touched->NumClear() << " of " << mappedBase << " pages");
+    }
+    delete pageTable;
+    delete [] swapSlot;
+    delete touched;
+    delete mappedPages;
+    numSpaces--;
+    delete executable;			// close file
 }
 
 
@@ -133,12 +247,9 @@ AddrSpace::~AddrSpace()
 bool 
 AddrSpace::Load(char *fileName) 
 {
-    OpenFile *executable = kernel->fileSystem->Open(fileName);
-    NoffHeader noffH;
     unsigned int size;
-    unsigned int code_addr;    // used to save translated address
-    unsigned int initData_addr;
-    
+
+    executable = kernel->fileSystem->Open(fileName);
     if (executable == NULL) {
 	cerr << "Unable to open file " << fileName << "\n";
 	return FALSE;
@@ -165,77 +276,32 @@ AddrSpace::Load(char *fileName)
     numPages = divRoundUp(size, PageSize);
     size = numPages * PageSize;
 
-    ASSERT(numPages <= NumPhysPages);		// check we're not trying
-						// to run anything too big --
-						// at least until we have
-						// virtual memory
-    pageTable = new TranslationEntry[numPages];
-    for(int i = 0, j = 0; i < numPages; i ++) {
-        pageTable[i].virtualPage = i;
-        
-        while(j < NumPhysPages 
-                && AddrSpace::inUsedPhyPages[j] == TRUE) {
-            j ++;
-            ASSERT(j < NumPhysPages); // do not reach out NumPhyPages
-                                      // normally, this won't happen 
-        }
-        AddrSpace::inUsedPhyPages[j] = TRUE;
-        pageTable[i].physicalPage = j;
-	    pageTable[i].valid = TRUE;
-	    pageTable[i].use = FALSE;
-	    pageTable[i].dirty = FALSE;
-	    pageTable[i].readOnly = FALSE;  
-    }
+// files are mapped above the stack, in pages that are only valid while
+// they are (see MapFile)
+    mappedBase = numPages;
+    numPages += divRoundUp(MappedRegionSize, PageSize);
+    mappedPages = new Bitmap(numPages - mappedBase);
 
+// no page is in memory yet: each is read in from the executable the
+// first time it is touched (see PageIn), so the program may be bigger
+// than physical memory
+    pageTable = kernel->machine->NewPageTable(numPages);
+    swapSlot = new int[numPages];
+    for (int i = 0; i < numPages; i++)
+	swapSlot[i] = -1;
+    touched = new Bitmap(numPages);
+    kernel->stats->numUserPages += mappedBase;
 
-    
-    // translate address
-    Translate(noffH.code.virtualAddr, &code_addr, 1);
-    Translate(noffH.initData.virtualAddr, &initData_addr, 1);
+    if (pageTable->CanShareFrames())
+	textId = kernel->frameTable->TextId(fileName);
+    if (kernel->tlbManager != NULL)
+	asid = kernel->tlbManager->AllocateAsid(this);
 
     DEBUG(dbgAddr, "Initializing address space: " << numPages << ", " << size);
 
+    if (kernel->machine->profile != NULL)
+	LoadSymbols(executable, &noffH);
 
-
-// then, copy in the code and data segments into memory
-// Note: this code assumes that virtual address = physical address
-    if (noffH.code.size > 0) {
-        DEBUG(dbgAddr, "Initializing code segment.");
-	DEBUG(dbgAddr, noffH.code.virtualAddr << ", " << noffH.code.size);
-        /*executable->ReadAt(
-		&(kernel->machine->mainMemory[noffH.code.virtualAddr]), 
-			noffH.code.size, noffH.code.inFileAddr);*/
-        executable->ReadAt(
-		&(kernel->machine->mainMemory[code_addr]), 
-			noffH.code.size, noffH.code.inFileAddr);
-    }
-    if (noffH.initData.size > 0) {
-        DEBUG(dbgAddr, "Initializing data segment.");
-	DEBUG(dbgAddr, noffH.initData.virtualAddr << ", " << noffH.initData.size);
-        /*executable->ReadAt(
-		&(kernel->machine->mainMemory[noffH.initData.virtualAddr]),
-			noffH.initData.size, noffH.initData.inFileAddr);*/
-        executable->ReadAt(
-		&(kernel->machine->mainMemory[initData_addr]),
-			noffH.initData.size, noffH.initData.inFileAddr);
-    }
-
-#ifdef RDATA
-    unsigned RDATA_addr;
-    Translate(noffH.readonlyData.virtualAddr, &RDATA_addr, 0);
-    if (noffH.readonlyData.size > 0) {
-        DEBUG(dbgAddr, "Initializing read only data segment.");
-	DEBUG(dbgAddr, noffH.readonlyData.virtualAddr << ", " << noffH.readonlyData.size);
-        /*executable->ReadAt(
-		&(kernel->machine->mainMemory[noffH.readonlyData.virtualAddr]),
-			noffH.readonlyData.size, noffH.readonlyData.inFileAddr);*/
-        executable->ReadAt(
-		&(kernel->machine->mainMemory[RDATA_addr]),
-			noffH.readonlyData.size, noffH.readonlyData.inFileAddr);
-    }
-#endif
-
-    delete executable;			// close file
     return TRUE;			// success
 }
 
@@ -294,11 +360,13 @@ AddrSpace::InitRegisters()
     // after start will be at virtual address four.
     machine->WriteRegister(NextPCReg, 4);
 
-   // Set the stack register to the end of the address space, where we
-   // allocated the stack; but subtract off a bit, to make sure we don't
-   // accidentally reference off the end!
-    machine->WriteRegister(StackReg, numPages * PageSize - 16);
-    DEBUG(dbgAddr, "Initializing stack pointer: " << numPages * PageSize - 16);
+   // Set the stack register to the end of the program, where we
+   // allocated the stack (below the pages files are mapped to); but
+   // subtract off a bit, to make sure we don't accidentally reference
+   // off the end!
+    machine->WriteRegister(StackReg, mappedBase * PageSize - 16);
+    DEBUG(dbgAddr, "Initializing stack pointer: " << 
+					mappedBase * PageSize - 16);
 }
 
 //----------------------------------------------------------------------
@@ -317,15 +385,179 @@ void AddrSpace::SaveState()
 // 	On a context switch, restore the machine state so that
 //	this address space can run.
 //
-//      For now, tell the machine where to find the page table.
+//      For now, tell the machine where to find the page table (or, if
+//	there is a TLB, which of its entries are ours), and make it
+//	forget any translations it cached for the old one.
 //----------------------------------------------------------------------
 
 void AddrSpace::RestoreState() 
 {
-    kernel->machine->pageTable = pageTable;
-    kernel->machine->pageTableSize = numPages;
+    if (kernel->machine->tlb != NULL)
+	kernel->machine->currentAsid = asid;
+    else {
+	kernel->machine->pageTable = pageTable;
+    }
+    kernel->machine->FlushTranslations();
+}
+
+
+//----------------------------------------------------------------------
+// AddrSpace::Checkpoint, AddrSpace::Restore
+// 	Write the page table to the checkpoint file "fd", or read it back
+//	(instead of loading a program).  The pages in memory are saved
+//	with the rest of mainMemory, so a restored address space claims
+//	the same physical pages it had; the pages paged out are saved
+//	with the disk, so it claims the same swap slots.  The other pages
+//	are still read from the executable, "fileName", when touched.
+//	The TLB is not saved; the use and dirty bits in it are copied to
+//	the page table first.  Whatever kind of page table it is, it is
+//	saved as one entry per page, invalid for pages not in memory.
+//	Mapped files are not saved, any more than open files are: their
+//	pages are saved as not in memory, and not mapped when restored.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::Checkpoint(int fd)
+{
+    if (asid >= 0)
+	kernel->tlbManager->SyncAll(asid);
+    WriteFile(fd, (char *) &noffH, sizeof(NoffHeader));
+    WriteFile(fd, (char *) &numPages, sizeof(int));
+    for (int i = 0; i < numPages; i++) {
+	TranslationEntry entry, *mapped = pageTable->Lookup(i);
+
+	if ((mapped != NULL) && (i < mappedBase))
+	    entry = *mapped;
+	else
+	    entry.valid = FALSE;
+	WriteFile(fd, (char *) &entry, sizeof(TranslationEntry));
+    }
+    WriteFile(fd, (char *) swapSlot, numPages * sizeof(int));
 }
 
+void
+AddrSpace::Restore(int fd, char *fileName)
+{
+    executable = kernel->fileSystem->Open(fileName);
+    if (executable == NULL) {
+	cerr << "Unable to open file " << fileName << "\n";
+	Abort();
+    }
+    Read(fd, (char *) &noffH, sizeof(NoffHeader));
+    Read(fd, (char *) &numPages, sizeof(int));
+    pageTable = kernel->machine->NewPageTable(numPages);
+    for (int i = 0; i < numPages; i++) {
+	TranslationEntry entry;
+
+	Read(fd, (char *) &entry, sizeof(TranslationEntry));
+	if (entry.valid) {
+	    *pageTable->Map(i, entry.physicalPage) = entry;
+	    kernel->frameTable->Reserve(entry.physicalPage, this, i);
+	}
+    }
+    swapSlot = new int[numPages];
+    Read(fd, (char *) swapSlot, numPages * sizeof(int));
+    mappedBase = numPages - divRoundUp(MappedRegionSize, PageSize);
+    mappedPages = new Bitmap(numPages - mappedBase);
+    touched = new Bitmap(numPages);
+    for (int i = 0; i < numPages; i++) {
+	if (swapSlot[i] >= 0)
+	    kernel->swapArea->Mark(swapSlot[i]);
+	if ((swapSlot[i] >= 0) || (pageTable->Lookup(i) != NULL))
+	    touched->Mark(i);
+    }
+    if (pageTable->CanShareFrames())
+	textId = kernel->frameTable->TextId(fileName);
+    if (kernel->tlbManager != NULL)
+	asid = kernel->tlbManager->AllocateAsid(this);
+    DEBUG(dbgAddr, "Restored address space: " << numPages << " pages");
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::Fork
+//  Return a copy of this address space, for a child forked to run
+//  the same program, "fileName".  The pages in memory aren't copied:
+//  the child maps the same frames, and both of us map them read-only,
+//  so that whichever writes a page first gets its own copy of it then
+//  (see CopyOnWrite).  Pages paged out share their swap slot until
+//  one of us writes the page out again; the rest are read from the
+//  executable, as usual.
+//
+//  An inverted page table has one entry per frame, so can't map a
+//  frame twice; with one, the child is given copies of the pages in
+//  memory right away.  Taking frames for them may page out pages of
+//  ours not yet copied, so the child takes over our swap slots for
+//  those only after the copying, from where they ended up.  The child
+//  has none of our files mapped.
+//----------------------------------------------------------------------
+
+AddrSpace *
+AddrSpace::Fork(char *fileName)
+{
+    FrameTable *frameTable = kernel->frameTable;
+    char *memory = kernel->machine->mainMemory;
+    AddrSpace *child = new AddrSpace();
+
+    child->executable = kernel->fileSystem->Open(fileName);
+    ASSERT(child->executable != NULL);          // we have it open
+    child->noffH = noffH;
+    child->textId = textId;
+    child->numPages = numPages;
+    child->mappedBase = mappedBase;
+    child->mappedPages = new Bitmap(numPages - mappedBase);
+    child->pageTable = kernel->machine->NewPageTable(numPages);
+    child->swapSlot = new int[numPages];
+    child->touched = new Bitmap(numPages);
+    kernel->stats->numUserPages += mappedBase;
+    if (kernel->tlbManager != NULL)
+        child->asid = kernel->tlbManager->AllocateAsid(child);
+
+    frameTable->Acquire();              // nothing else is paged meanwhile
+    for (int i = 0; i < numPages; i++) {
+        child->swapSlot[i] = -1;        // filled in below
+        if (touched->Test(i))
+            child->touched->Mark(i);
+    }
+    for (int i = 0; i < mappedBase; i++) {
+        TranslationEntry *entry = pageTable->Lookup(i), *copy;
+        int frame;
+
+        if (entry == NULL)
+            continue;
+        if (asid >= 0)                  // get its bits, and take it out
+            kernel->tlbManager->Sync(asid, i, TRUE);    // of the TLB
+        child->swapSlot[i] = swapSlot[i];       // before Allocate() below
+        if (swapSlot[i] >= 0)                   // can page the copy out
+            kernel->swapArea->Share(swapSlot[i]);
+        if (child->pageTable->CanShareFrames()) {
+            entry->readOnly = TRUE;
+            copy = child->pageTable->Map(i, entry->physicalPage);
+            *copy = *entry;
+            frameTable->Share(entry->physicalPage, child, i);
+            kernel->stats->numPagesShared++;
+        } else {
+            frameTable->Pin(entry->physicalPage);       // not to be
+            frame = frameTable->Allocate(child, i);     // paged out
+            frameTable->Unpin(entry->physicalPage);
+            kernel->machine->InvalidateDecodedPage(frame);
+            bcopy(memory + entry->physicalPage * PageSize, 
+                                        memory + frame * PageSize, PageSize);
+            copy = child->pageTable->Map(i, frame);
+            copy->dirty = entry->dirty;
+            frameTable->Map(frame);
+        }
+    }
+    for (int i = 0; i < numPages; i++) {        // the pages not copied
+        if ((child->swapSlot[i] < 0) && (swapSlot[i] >= 0)) {
+            child->swapSlot[i] = swapSlot[i];
+            kernel->swapArea->Share(swapSlot[i]);
+        }
+    }
+    frameTable->Release();
+    kernel->machine->FlushTranslations();       // ours are read-only now
+    DEBUG(dbgAddr, "Forked address space: " << numPages << " pages");
+    return child;
+}
 
 //----------------------------------------------------------------------
 // AddrSpace::Translate
@@ -333,6 +565,7 @@ void AddrSpace::RestoreState()
 //  and store the physical address in _paddr_.
 //  The flag _isReadWrite_ is false (0) for read-only access; true (1)
 //  for read-write access.
+//  A page that is not in memory is paged in.
 //  Return any exceptions caused by the address translation.
 //----------------------------------------------------------------------
 ExceptionType
@@ -343,14 +576,20 @@ AddrSpace::Translate(unsigned int vaddr, unsigned int *paddr, int isReadWrite)
     unsigned int      vpn    = vaddr / PageSize;
     unsigned int      offset = vaddr % PageSize;
 
-    if(vpn >= numPages) {
+    if(!InSpace(vpn)) {
         return AddressErrorException;
     }
 
-    pte = &pageTable[vpn];
-
-    if(isReadWrite && pte->readOnly) {
-        return ReadOnlyException;
+    for (;;) {
+        pte = pageTable->Lookup(vpn);
+        if (pte == NULL)
+            PageIn(vaddr);      // not in memory: page it in (it may be
+                                // paged out again while we wait for
+                                // the frame table, so check again)
+        else if (isReadWrite && pte->readOnly)
+            CopyOnWrite(vaddr); // shared since a Fork
+        else
+            break;
     }
 
     pfn = pte->physicalPage;
@@ -363,13 +602,14 @@ AddrSpace::Translate(unsigned int vaddr, unsigned int *paddr, int isReadWrite)
     }
 
     pte->use = TRUE;          // set the use, dirty bits
+    Touch(vpn);
 
     if(isReadWrite)
         pte->dirty = TRUE;
 
     *paddr = pfn*PageSize + offset;
 
-    ASSERT((*paddr < MemorySize));
+    ASSERT((*paddr < (unsigned) MemorySize));
 
     //cerr << " -- AddrSpace::Translate(): vaddr: " << vaddr <<
     //  ", paddr: " << *paddr << "\n";
@@ -377,6 +617,625 @@ AddrSpace::Translate(unsigned int vaddr, unsigned int *paddr, int isReadWrite)
     return NoException;
 }
 
+//----------------------------------------------------------------------
+// ReadSegment
+//  Read the part of "segment" that is in page "vpn" from "executable",
+//  into the same place in "page".  Return FALSE if none of it is.
+//----------------------------------------------------------------------
+
+static bool
+ReadSegment(OpenFile *executable, Segment *segment, int vpn, char *page)
+{
+    int start = max(segment->virtualAddr, vpn * PageSize);
+    int end = min(segment->virtualAddr + segment->size, (vpn + 1) * PageSize);
+
+    if ((segment->size <= 0) || (start >= end))
+        return FALSE;
+    DEBUG(dbgAddr, "Reading " << end - start << " bytes at " << start);
+    executable->ReadAt(page + (start - vpn * PageSize), end - start,
+                        segment->inFileAddr + (start - segment->virtualAddr));
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// TransferMapped
+//  Read page "vpn" of "mapping" from its file into "page", or, if
+//  "writing", write it back; only the part of the page inside the
+//  mapping.  The zeroes past the end of the file are not written
+//  back, so a mapping longer than its file doesn't make it longer.
+//----------------------------------------------------------------------
+
+static void
+TransferMapped(MappedFile *mapping, int vpn, char *page, bool writing)
+{
+    int start = (vpn - mapping->firstPage) * PageSize;
+    int length = min(PageSize, mapping->length - start);
+
+    if (writing)
+        length = min(length, 
+                mapping->fileLength - (mapping->offset + start));
+    if (length <= 0)                    // all past the end of the file
+        return;
+
+    DEBUG(dbgAddr, (writing ? "Writing " : "Reading ") << length << 
+                " bytes of mapped file " << mapping->id << " at " << 
+                mapping->offset + start);
+    if (writing)
+        mapping->file->WriteAt(page, length, mapping->offset + start);
+    else
+        mapping->file->ReadAt(page, length, mapping->offset + start);
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::FillPage
+//  Read in the contents of page "vpn" to "page" in mainMemory: from
+//  swap, if it was paged out after being changed; otherwise from the
+//  code and data segments of the executable that it overlaps, with
+//  the rest of it (uninitialized data and stack) zeroed.  A page that
+//  overlaps none of them is just zeroed, without touching the disk.
+//  A page of a mapped file is read from the file, and zeroed past
+//  the end of the mapping, or of the file.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::FillPage(int vpn, char *page)
+{
+    MappedFile *mapping = FindMapping(vpn);
+    bool read;
+
+    if (mapping != NULL) {
+        bzero(page, PageSize);
+        TransferMapped(mapping, vpn, page, FALSE);
+        kernel->stats->numPageIns++;
+        return;
+    }
+    if (swapSlot[vpn] >= 0) {
+        kernel->swapArea->ReadPage(swapSlot[vpn], page);
+        kernel->stats->numPageIns++;
+        return;
+    }
+    bzero(page, PageSize);
+    read = ReadSegment(executable, &noffH.code, vpn, page);
+    read |= ReadSegment(executable, &noffH.initData, vpn, page);
+#ifdef RDATA
+    read |= ReadSegment(executable, &noffH.readonlyData, vpn, page);
+#endif
+    if (read)
+        kernel->stats->numPageIns++;
+    else
+        kernel->stats->numZeroFills++;
+}
+
+//----------------------------------------------------------------------
+// Overlaps
+//  Does "segment" cover any of the bytes from "start" up to "end"?
+//----------------------------------------------------------------------
+
+static bool
+Overlaps(Segment *segment, int start, int end)
+{
+    return (segment->size > 0) && (segment->virtualAddr < end) &&
+                        (start < segment->virtualAddr + segment->size);
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::IsText
+//  Return TRUE if page "vpn" holds nothing the program may write: it
+//  lies below the end of the code (and read-only data), and no data
+//  segment covers any of it.  Such a page is the same for everybody
+//  running the executable.
+//----------------------------------------------------------------------
 
+bool
+AddrSpace::IsText(int vpn)
+{
+    int start = vpn * PageSize, end = (vpn + 1) * PageSize;
+    int textEnd = noffH.code.virtualAddr + noffH.code.size;
 
+#ifdef RDATA
+    if (noffH.readonlyData.size > 0)
+        textEnd = max(textEnd, noffH.readonlyData.virtualAddr +
+                                        noffH.readonlyData.size);
+#endif
+    return (end <= textEnd) && !Overlaps(&noffH.initData, start, end) &&
+                                !Overlaps(&noffH.uninitData, start, end);
+}
 
+//----------------------------------------------------------------------
+// AddrSpace::ClaimFrame
+//  Find a frame for page _vpn_.  A text page (see IsText) that another
+//  address space running the same executable has in memory is mapped
+//  to its frame, read-only, and -1 is returned.  Otherwise return a
+//  busy frame to read the page into (see FrameTable::Allocate); set
+//  _text_ if the page should be mapped read-only, and left in the
+//  frame table's text page cache for others, once it is read in.
+//----------------------------------------------------------------------
+
+int
+AddrSpace::ClaimFrame(int vpn, bool *text)
+{
+    FrameTable *frameTable = kernel->frameTable;
+    int frame;
+
+    *text = (textId >= 0) && (swapSlot[vpn] < 0) && IsText(vpn);
+    frame = *text ? frameTable->FindText(textId, vpn) : -1;
+    if (frame >= 0) {
+        DEBUG(dbgAddr, "Sharing text page " << vpn << " in frame " << frame);
+        pageTable->Map(vpn, frame)->readOnly = TRUE;
+        frameTable->Share(frame, this, vpn);
+        kernel->stats->numTextPagesShared++;
+        return -1;
+    }
+    frame = frameTable->Allocate(this, vpn);
+    DEBUG(dbgAddr, "Paging in page " << vpn << " to frame " << frame);
+    kernel->machine->InvalidateDecodedPage(frame);      // about to be
+    return frame;                                       // overwritten
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::PageIn
+//  Handle a page fault at _vaddr_: find a frame for its page (which
+//  may mean paging out some other page), read the page into it, and
+//  map it.  The thread waits for the disk, and for any other thread
+//  that is paging.
+//
+//  While the program faults on one page after another, as it does
+//  walking through an array, the pages after the one faulted on are
+//  brought in too, so it needn't fault on them: twice as many each
+//  time, up to MaxFaultAround.  Only free frames are used for them,
+//  and the run stops at the first page already in memory, or at the
+//  end of the program or of a mapped file.  The pages to be read from
+//  swap are read first, in slot order, those in adjacent slots with
+//  one disk request (see SwapArea::ReadPages).  Only the page faulted on
+//  counts as touched; the others do once their use bit is seen set.
+//
+//  Return FALSE, doing nothing, if _vaddr_ is not in the address space.
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::PageIn(unsigned int vaddr)
+{
+    FrameTable *frameTable = kernel->frameTable;
+    char *memory = kernel->machine->mainMemory;
+    int vpn = vaddr / PageSize;
+    int page[MaxFaultAround], frame[MaxFaultAround];
+    bool text[MaxFaultAround];
+    int slot[MaxFaultAround];
+    char *into[MaxFaultAround];
+    int count = 0, numSwapped = 0, last;
+
+    if (!InSpace(vpn))
+        return FALSE;
+    kernel->stats->numPageFaults++;
+    frameTable->Acquire();
+    if (pageTable->Lookup(vpn) == NULL) {
+        frameTable->Fault();                    // before any Allocate
+        if (vpn == nextFault)                   // carrying on in order
+            faultAround = min(2 * faultAround, MaxFaultAround);
+        else
+            faultAround = 1;
+        for (last = vpn; (last < vpn + faultAround) && (last < numPages); 
+                                                                last++) {
+            if ((last > vpn) && ((pageTable->Lookup(last) != NULL) ||
+                        (frameTable->NumFree() == 0) || !InSpace(last) ||
+                        (FindMapping(last) != FindMapping(vpn))))
+                break;
+            frame[count] = ClaimFrame(last, &text[count]);
+            if (frame[count] >= 0) {
+                if (last > vpn)         // read in, not just shared
+                    kernel->stats->numFaultedAround++;
+                page[count++] = last;
+            }
+        }
+        nextFault = last;
+        Touch(vpn);
+
+        for (int i = 0; i < count; i++) {       // swap first, by slot
+            if (swapSlot[page[i]] >= 0) {
+                slot[numSwapped] = swapSlot[page[i]];
+                into[numSwapped++] = memory + frame[i] * PageSize;
+            }
+        }
+        kernel->swapArea->ReadPages(slot, into, numSwapped);
+        kernel->stats->numPageIns += numSwapped;
+        for (int i = 0; i < count; i++) {
+            if (swapSlot[page[i]] < 0)
+                FillPage(page[i], memory + frame[i] * PageSize);
+            pageTable->Map(page[i], frame[i])->readOnly = text[i];
+            frameTable->Map(frame[i]);
+            if (text[i])
+                frameTable->EnterText(frame[i], textId, page[i]);
+        }
+    }
+    frameTable->Release();
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::CopyOnWrite
+//  Handle a write to the page holding _vaddr_, which is read-only
+//  because it is shared since a Fork: copy it to a frame of our own,
+//  or, if nobody else shares it any more, just make it writable.  If
+//  the page was paged out meanwhile, nothing is done; the retried
+//  write faults it back in.
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::CopyOnWrite(unsigned int vaddr)
+{
+    FrameTable *frameTable = kernel->frameTable;
+    char *memory = kernel->machine->mainMemory;
+    int vpn = vaddr / PageSize;
+    TranslationEntry *entry;
+    int shared, frame;
+
+    if (!InSpace(vpn))
+        return FALSE;
+    frameTable->Acquire();
+    entry = pageTable->Lookup(vpn);
+    if ((entry != NULL) && entry->readOnly) {
+        if (asid >= 0)                  // the TLB has it read-only too
+            kernel->tlbManager->Sync(asid, vpn, TRUE);
+        Touch(vpn);                     // the new entry's use bit is clear
+        shared = entry->physicalPage;
+        if (frameTable->RefCount(shared) == 1) {
+            DEBUG(dbgAddr, "Page " << vpn << " is no longer shared");
+            frameTable->ForgetText(shared);     // no longer as read in
+            entry->readOnly = FALSE;
+        } else {
+            frameTable->Fault();
+            frame = frameTable->Allocate(this, vpn);  // can't take a
+                                                      // shared frame
+            DEBUG(dbgAddr, "Copying shared page " << vpn << " to frame "
+                                                                << frame);
+            kernel->machine->InvalidateDecodedPage(frame);
+            bcopy(memory + shared * PageSize, memory + frame * PageSize, 
+                                                                PageSize);
+            frameTable->Free(shared, this);
+            pageTable->Unmap(vpn);
+            entry = pageTable->Map(vpn, frame);
+            entry->dirty = TRUE;        // it is about to differ from swap
+            frameTable->Map(frame);
+            kernel->stats->numCopiesOnWrite++;
+        }
+    }
+    frameTable->Release();
+    kernel->machine->FlushTranslations();
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::RefillTLB
+//  Handle a TLB miss at _vaddr_: page in the page if it isn't in
+//  memory, and load the TLB from its page table entry.  If the page is
+//  paged out again while we wait for the disk, nothing is loaded, and
+//  the retried access just misses again.
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::RefillTLB(unsigned int vaddr)
+{
+    int vpn = vaddr / PageSize;
+    TranslationEntry *entry;
+
+    if (!InSpace(vpn))
+        return FALSE;
+    if (pageTable->Lookup(vpn) == NULL)
+        PageIn(vaddr);
+    entry = pageTable->Lookup(vpn);
+    if (entry != NULL)
+        kernel->tlbManager->Refill(asid, entry);
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::PageEntry
+//  Return the page table entry of page _vpn_, which is in memory,
+//  noting first whether the program has used the page (see Touch).
+//----------------------------------------------------------------------
+
+TranslationEntry *
+AddrSpace::PageEntry(int vpn)
+{
+    TranslationEntry *entry = pageTable->Lookup(vpn);
+
+    ASSERT(entry != NULL);
+    if (entry->use)                     // before a policy clears it
+        Touch(vpn);
+    return entry;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::PageOut
+//  Called by the frame table, to take back the frame holding page
+//  _vpn_.  Unmap the page first, so that touching it faults (and waits
+//  until we are done); then, if it has changed since it was read in,
+//  write it to its swap slot, to be read back from there next time --
+//  or, if it is a page of a mapped file, back to the file.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::PageOut(int vpn)
+{
+    TranslationEntry *entry = pageTable->Lookup(vpn);
+    MappedFile *mapping = FindMapping(vpn);
+    char *page;
+    bool dirty;
+
+    ASSERT(entry != NULL);
+    page = &kernel->machine->mainMemory[entry->physicalPage * PageSize];
+    if (asid >= 0)                      // the TLB may know it is dirty
+        kernel->tlbManager->Sync(asid, vpn, TRUE);
+    dirty = entry->dirty;
+    if (entry->use)
+        Touch(vpn);
+    pageTable->Unmap(vpn);
+    kernel->machine->FlushTranslations();
+    if (dirty && (mapping != NULL)) {
+        TransferMapped(mapping, vpn, page, TRUE);
+        kernel->stats->numPageOuts++;
+    } else if (dirty) {
+        if ((swapSlot[vpn] >= 0) && kernel->swapArea->IsShared(swapSlot[vpn])) {
+            kernel->swapArea->Free(swapSlot[vpn]);  // leave the old page
+            swapSlot[vpn] = -1;                     // to the others
+        }
+        if (swapSlot[vpn] < 0)
+            swapSlot[vpn] = kernel->swapArea->Allocate();
+        if (swapSlot[vpn] < 0) {
+            cerr << "Out of swap space\n";
+            Abort();
+        }
+        kernel->swapArea->WritePage(swapSlot[vpn], page);
+        kernel->stats->numPageOuts++;
+    }
+}
+
+
+//----------------------------------------------------------------------
+// AddrSpace::Touch
+//  Count page _vpn_ as used by the program, if it hasn't been yet.
+//  Pages brought in by fault-around are only counted once they are
+//  seen to be used: by their use bit, when the replacement policy
+//  looks at it, or when they are paged out or freed.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::Touch(int vpn)
+{
+    if ((vpn < mappedBase) && !touched->Test(vpn)) {
+        touched->Mark(vpn);
+        kernel->stats->numPagesTouched++;
+    }
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::InSpace
+//  Is page _vpn_ one of the program's, or one a file is mapped to?
+//  The rest of the pages above the stack aren't in the address space.
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::InSpace(int vpn)
+{
+    if ((vpn < 0) || (vpn >= numPages))
+        return FALSE;
+    return (vpn < mappedBase) || mappedPages->Test(vpn - mappedBase);
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::FindMapping
+//  Return the mapping page _vpn_ is in, or NULL if it isn't in one.
+//----------------------------------------------------------------------
+
+MappedFile *
+AddrSpace::FindMapping(int vpn)
+{
+    if (vpn < mappedBase)
+        return NULL;
+    for (MappedFile *mapping = mappings; mapping != NULL; 
+                                                mapping = mapping->next)
+        if ((vpn >= mapping->firstPage) && 
+                        (vpn < mapping->firstPage + mapping->numPages))
+            return mapping;
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::MapFile
+//  Map _length_ bytes of the open file _id_, from byte _offset_ on, to
+//  the first run of free pages above the stack that is long enough.
+//  None of it is read yet: each page is read from the file when it is
+//  first touched (see FillPage).  The mapping opens the file again, so
+//  that closing _id_ doesn't affect it.  Return the address the
+//  mapping starts at, or -1 if the file isn't open, or there is no
+//  room.
+//
+//  Only the stub file system has OpenFileIds; with the real one, no
+//  file can be mapped.
+//----------------------------------------------------------------------
+
+int
+AddrSpace::MapFile(int id, int offset, int length)
+{
+    int regionPages = numPages - mappedBase;
+    int pages, run = 0, i;
+    MappedFile *mapping;
+    OpenFile *file;
+
+    if ((offset < 0) || (length <= 0))
+        return -1;
+    pages = divRoundUp(length, PageSize);
+    for (i = 0; (i < regionPages) && (run < pages); i++)
+        run = mappedPages->Test(i) ? 0 : run + 1;
+    if (run < pages)
+        return -1;
+#ifdef FILESYS_STUB
+    file = kernel->fileSystem->ReopenFileId(id);
+#else
+    file = NULL;
+#endif
+    if (file == NULL)
+        return -1;
+
+    mapping = new MappedFile;
+    mapping->file = file;
+    mapping->id = id;
+    mapping->offset = offset;
+    mapping->length = length;
+    mapping->fileLength = file->Length();
+    mapping->firstPage = mappedBase + i - pages;
+    mapping->numPages = pages;
+    kernel->frameTable->Acquire();
+    for (i = 0; i < pages; i++)
+        mappedPages->Mark(mapping->firstPage - mappedBase + i);
+    mapping->next = mappings;
+    mappings = mapping;
+    kernel->frameTable->Release();
+    DEBUG(dbgAddr, "Mapped " << length << " bytes of file " << id << 
+                " to pages " << mapping->firstPage << " on");
+    return mapping->firstPage * PageSize;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::UnmapFile
+//  Unmap the mapping starting at _vaddr_, returning FALSE if there is
+//  none.
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::UnmapFile(unsigned int vaddr)
+{
+    MappedFile *mapping;
+
+    if (vaddr % PageSize != 0)
+        return FALSE;
+    mapping = FindMapping(vaddr / PageSize);
+    if ((mapping == NULL) || (mapping->firstPage != (int) (vaddr / PageSize)))
+        return FALSE;
+    RemoveMapping(mapping);
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::RemoveMapping
+//  Take _mapping_ out of the address space: write the pages of it that
+//  are in memory back to the file, if they have changed, free their
+//  frames, and close the mapping's handle on the file.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::RemoveMapping(MappedFile *mapping)
+{
+    FrameTable *frameTable = kernel->frameTable;
+    MappedFile **link = &mappings;
+
+    frameTable->Acquire();
+    for (int vpn = mapping->firstPage; 
+                vpn < mapping->firstPage + mapping->numPages; vpn++) {
+        TranslationEntry *entry = pageTable->Lookup(vpn);
+        int frame;
+
+        if (entry == NULL)
+            continue;
+        if (asid >= 0)                  // the TLB may know it is dirty
+            kernel->tlbManager->Sync(asid, vpn, TRUE);
+        frame = entry->physicalPage;
+        if (entry->dirty) {
+            TransferMapped(mapping, vpn, 
+                &kernel->machine->mainMemory[frame * PageSize], TRUE);
+            kernel->stats->numPageOuts++;
+        }
+        pageTable->Unmap(vpn);
+        frameTable->Free(frame, this);
+    }
+    for (int i = 0; i < mapping->numPages; i++)
+        mappedPages->Clear(mapping->firstPage - mappedBase + i);
+    while (*link != mapping)
+        link = &(*link)->next;
+    *link = mapping->next;
+    frameTable->Release();
+    kernel->machine->FlushTranslations();
+    DEBUG(dbgAddr, "Unmapped file " << mapping->id << " from pages " << 
+                                                mapping->firstPage << " on");
+    delete mapping->file;
+    delete mapping;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::ReadString
+//  Copy the null-terminated string at virtual address _vaddr_ into
+//  _buffer_, a page at a time, so a string that crosses into another
+//  frame is still copied correctly.  Return FALSE if part of it is
+//  not mapped, or if it doesn't fit in the _size_ bytes of _buffer_.
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::ReadString(unsigned int vaddr, char *buffer, int size)
+{
+    unsigned int paddr;
+    int i = 0;
+
+    while (i < size) {
+        if (Translate(vaddr, &paddr, 0) != NoException)
+            return FALSE;
+        do {                            // to the end of this page
+            buffer[i] = kernel->machine->mainMemory[paddr];
+            if (buffer[i] == '\0')
+                return TRUE;
+            i++; vaddr++; paddr++;
+        } while ((i < size) && (vaddr % PageSize != 0));
+    }
+    return FALSE;                       // too long
+}
+
+//----------------------------------------------------------------------
+// UserBuffer::UserBuffer
+//  Break the _size_ bytes at virtual address _vaddr_ in _space_ into
+//  spans of mainMemory, translating (and paging in, and pinning) each
+//  page once.  Pages that are in consecutive frames share a span.  If
+//  the kernel will write the buffer (_writing_), throw away any decoded
+//  instructions of the frames, since they are about to change behind
+//  the simulator's back.
+//----------------------------------------------------------------------
+
+UserBuffer::UserBuffer(AddrSpace *space, unsigned int vaddr, int size,
+                                                        bool writing)
+{
+    char *memory = kernel->machine->mainMemory;
+    unsigned int paddr;
+    int maxPages = divRoundUp(vaddr % PageSize + max(size, 0), PageSize) + 1;
+
+    numSpans = numFrames = 0;
+    spans = new Span[maxPages];
+    frames = new int[maxPages];
+    while (size > 0) {
+        int length = min(size, PageSize - (int) (vaddr % PageSize));
+
+        if (space->Translate(vaddr, &paddr, writing) != NoException) {
+            numSpans = -1;
+            return;
+        }
+        frames[numFrames++] = paddr / PageSize;
+        kernel->frameTable->Pin(paddr / PageSize);
+        if (writing)
+            kernel->machine->InvalidateDecodedPage(paddr / PageSize);
+        if ((numSpans > 0) && (spans[numSpans - 1].start + 
+                        spans[numSpans - 1].length == memory + paddr))
+            spans[numSpans - 1].length += length;       // same span
+        else {
+            spans[numSpans].start = memory + paddr;
+            spans[numSpans].length = length;
+            numSpans++;
+        }
+        vaddr += length;
+        size -= length;
+    }
+}
+
+UserBuffer::~UserBuffer()
+{
+    for (int i = 0; i < numFrames; i++)
+        kernel->frameTable->Unpin(frames[i]);
+    delete [] spans;
+    delete [] frames;
+}
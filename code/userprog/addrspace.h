@@ -13,6 +13,26 @@
 // Record --------------------------------------------------------
 // 2015/10/28 : Add constructor AddrSpace(int threadNum)
 // 2015/10/28 : add private field basePhyPageNum
+// 2026/10/17 : add Checkpoint() and Restore()
+// 2026/10/17 : add UserBuffer and ReadString(), for syscall arguments
+// 2026/10/17 : page in on demand: add PageIn(), PageOut(), and keep the
+//              executable open; UserBuffer pins its frames
+// 2026/10/17 : add PageEntry(), for the page replacement policies
+// 2026/10/17 : add RefillTLB() and an address-space ID, for -tlb
+// 2026/10/17 : pageTable is a PageTable of the kind chosen with -pt;
+//              remove AddrSpace(int threadNum) and basePhyPageNum
+// 2026/10/17 : add Fork() and CopyOnWrite(), for the Fork syscall
+// 2026/10/17 : add textId and IsText(), to share code pages between
+//              address spaces running the same executable
+// 2026/10/17 : add touched, the pages that have ever been brought in
+// 2026/10/17 : add faultAround and nextFault, to bring in the pages
+//              after a fault too when the program walks sequentially
+// 2026/10/17 : add MapFile(), UnmapFile() and MappedFile, to map open
+//              files into a region above the stack; PageIn() returns
+//              FALSE outside the address space
+// 2026/10/17 : add Touch(); touched holds the pages used, not just
+//              brought in
+// 2026/10/17 : add NumSpaces(), for Kernel::Checkpoint()
 // end Record ----------------------------------------------------
 
 #ifndef ADDRSPACE_H
@@ -20,19 +40,49 @@
 
 #include "copyright.h"
 #include "filesys.h"
+#include "noff.h"
+#include "pagetable.h"
+#include "bitmap.h"
 
 #define UserStackSize		1024 	// increase this as necessary!
 #define PageNumPerProc      32
+#define MaxFaultAround		8	// most pages brought in on a
+					// page fault (see PageIn)
+#define MappedRegionSize	8192	// bytes above the stack to map
+					// files into (see MapFile)
+
+class UserBuffer;
+
+// The following class defines a file mapped into an address space:
+// which pages it is mapped to, and what part of the file they hold.
+// The mapping has its own handle on the file, so it is unaffected by
+// the program (or any other) closing the OpenFileId it was mapped from.
+
+class MappedFile {
+  public:
+    OpenFile *file;		// the file
+    int id;			// the OpenFileId it was mapped from,
+				// for debugging (only the stub file
+				// system has them)
+    int offset;			// where in it the mapping starts
+    int length;			// how many bytes of it are mapped
+    int fileLength;		// how long the file was when mapped;
+				// pages are not written back past it
+    int firstPage;		// the pages it is mapped to
+    int numPages;
+    MappedFile *next;		// the address space's next mapping
+};
 
 class AddrSpace {
   public:
     AddrSpace();			// Create an address space.
-    AddrSpace(int threadNum);
     ~AddrSpace();			// De-allocate an address space
 
     bool Load(char *fileName);		// Load a program into addr space from
                                         // a file
 					// return false if not found
+					// (the pages are read in as they
+					// are touched: see PageIn)
 
     void Execute(char *fileName);             	// Run a program
 					// assumes the program has already
@@ -41,21 +91,145 @@ class AddrSpace {
     void SaveState();			// Save/restore address space-specific
     void RestoreState();		// info on a context switch 
 
+    AddrSpace *Fork(char *fileName);	// Return a copy of this address
+					// space, running _fileName_, that
+					// shares our pages until one of us
+					// writes them
+
+    void Checkpoint(int fd);		// Save the page table to the UNIX
+    void Restore(int fd, char *fileName);
+					// file "fd", or read it back in 
+					// place of Load()
+
     // Translate virtual address _vaddr_
     // to physical address _paddr_. _mode_
     // is 0 for Read, 1 for Write.
     ExceptionType Translate(unsigned int vaddr, unsigned int *paddr, int mode);
 
+    bool ReadString(unsigned int vaddr, char *buffer, int size);
+					// Copy the null-terminated string at
+					// _vaddr_ into _buffer_, which holds
+					// _size_ bytes.  Return FALSE if it
+					// is not all mapped, or is too long.
+
+    bool PageIn(unsigned int vaddr);	// Bring the page holding _vaddr_
+					// into memory, on a page fault;
+					// FALSE if _vaddr_ is not in the
+					// address space
+    void PageOut(int vpn);		// Give up the frame holding page
+					// _vpn_, saving it to swap if it
+					// has changed (see FrameTable)
+    bool CopyOnWrite(unsigned int vaddr);
+					// Make the page holding _vaddr_,
+					// shared since a Fork, writable,
+					// copying it if need be; FALSE if
+					// _vaddr_ is not in the address space
+    bool RefillTLB(unsigned int vaddr);	// Load the TLB with the page
+					// holding _vaddr_, paging it in if
+					// need be; FALSE if _vaddr_ is not
+					// in the address space
+    TranslationEntry *PageEntry(int vpn);
+					// For the replacement policy and
+					// the TLB: page _vpn_ must be in
+					// memory (the bits may be out of
+					// date: see TLBManager::Sync)
+    int PageTableBytes() { return pageTable->PeakBytesUsed(); }
+					// The most memory our page table
+					// has taken up
+    int Asid() { return asid; }
+    static int NumSpaces() { return numSpaces; }
+					// Address spaces not yet deleted
+
+    int MapFile(int id, int offset, int length);
+					// Map _length_ bytes of file _id_
+					// from _offset_ on; return where, or
+					// -1 if there is no room
+    bool UnmapFile(unsigned int vaddr);	// Unmap the mapping at _vaddr_,
+					// writing back its changed pages
+
   private:
-    TranslationEntry *pageTable;	// Assume linear page table translation
-					// for now!
-    unsigned int numPages;		// Number of pages in the virtual 
+    void FillPage(int vpn, char *page);	// Read in the contents of _vpn_
+    bool IsText(int vpn);		// Is _vpn_ all code or read-only
+					// data, so never written?
+    int ClaimFrame(int vpn, bool *text);
+					// Map _vpn_ to a frame holding it
+					// already, returning -1; or else
+					// return a busy frame to fill
+    void Touch(int vpn);		// The program has used page _vpn_
+    bool InSpace(int vpn);		// Is _vpn_ a page of the program,
+					// or of some mapping?
+    MappedFile *FindMapping(int vpn);	// The mapping _vpn_ is in, if any
+    void RemoveMapping(MappedFile *mapping);
+					// Write back and unmap its pages
+
+    PageTable *pageTable;		// Our pages that are in memory
+    int numPages;			// Number of pages in the virtual 
 					// address space
-    unsigned int basePhyPageNum;
+    int mappedBase;			// The first page above the stack,
+					// where files are mapped
+    Bitmap *mappedPages;		// Which pages from mappedBase on
+					// are taken by a mapping
+    MappedFile *mappings;		// The files mapped
+    int *swapSlot;			// For each page, where it is in the
+					// swap area (-1 if it has never
+					// been paged out changed)
+    OpenFile *executable;		// Where the other pages come from
+    NoffHeader noffH;			// and where in it they are
+    int faultAround;			// Pages to bring in on the next fault
+    int nextFault;			// where the next fault is, if the
+					// program carries on sequentially
+    Bitmap *touched;			// Pages the program has used (not
+					// just brought in by fault-around)
+    int textId;				// Which executable it is, to share
+					// text pages (-1 if they can't be)
+    int asid;				// ID tagging our TLB entries (-1
+					// if there is no TLB)
+    static int numSpaces;		// see NumSpaces()
+
     void InitRegisters();		// Initialize user-level CPU registers,
 					// before jumping to user code
-    static bool inUsedPhyPages[NumPhysPages];
+};
+
+// The following class defines a buffer in a user program's address
+// space, as the pieces ("spans") of it that are contiguous in
+// mainMemory -- one per page at most, fewer when neighbouring pages
+// happen to be in neighbouring frames.  System calls read and write
+// the spans in place, so no copy is needed, and a buffer that crosses
+// into a frame that isn't the next one is still handled correctly.
+//
+// Setting up a buffer marks its pages used (and dirty, if the kernel
+// is going to write it), as if the user program had touched them.
+// Pages that aren't in memory are paged in, and all of them are
+// pinned until the buffer is deleted, so that a system call that waits
+// (say, for the console) can't have them paged out from under it.
+
+class UserBuffer {
+  public:
+    UserBuffer(AddrSpace *space, unsigned int vaddr, int size, 
+							bool writing);
+				// Find where the _size_ bytes at _vaddr_
+				// are; _writing_ if the kernel will
+				// store into them
+    ~UserBuffer();
+
+    bool IsValid() { return numSpans >= 0; }
+				// FALSE if some of the buffer isn't mapped
+				// (or is read-only, when writing)
+    int NumSpans() { return numSpans; }
+    char *SpanStart(int i) { return spans[i].start; }
+    int SpanLength(int i) { return spans[i].length; }
+
+  private:
+    class Span {
+      public:
+	char *start;		// where the piece is in mainMemory
+	int length;		// how many bytes of the buffer it holds
+    };
 
+    Span *spans;
+    int numSpans;		// -1 if the buffer isn't valid
+    int *frames;		// the frames pinned
+    int numFrames;
 };
 
 #endif // ADDRSPACE_H
@@ -14,8 +14,10 @@
 //	Interrupts (which can also cause control to transfer from user
 //	code into the Nachos kernel) are handled elsewhere.
 //
-// For now, this only handles the Halt() system call.
-// Everything else core dumps.
+// System calls are dispatched through a table indexed by the system
+// call code, built by RegisterSyscalls.  Page faults page in the page
+// that was touched (or, with a TLB, load the TLB with it); writes to a
+// page shared since a Fork copy it; any other exception core dumps.
 //
 // Copyright (c) 1992-1996 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -25,6 +27,268 @@
 #include "main.h"
 #include "syscall.h"
 #include "ksyscall.h"
+
+// Longest file name or message a user program may pass, with its null.
+static const int MaxUserString = 256;
+
+//----------------------------------------------------------------------
+// ReadUserBuffer, WriteUserBuffer
+// 	Read into, or write out from, the user buffer of "size" bytes at
+//	"vaddr", in place, one span of mainMemory at a time.  Return the
+//	number of bytes transferred, or -1 if the buffer isn't all mapped
+//	or nothing could be transferred.
+//----------------------------------------------------------------------
+
+static int
+ReadUserBuffer(int vaddr, int size, OpenFileId f_id)
+{
+    UserBuffer buffer(kernel->currentThread->space, vaddr, size, TRUE);
+    int done = 0;
+
+    if (!buffer.IsValid())
+	return -1;
+    for (int i = 0; i < buffer.NumSpans(); i++) {
+	int n = SysRead(buffer.SpanStart(i), buffer.SpanLength(i), f_id);
+
+	if (n < 0)
+	    return (done > 0) ? done : n;
+	done += n;
+	if (n < buffer.SpanLength(i))
+	    break;			// end of file
+    }
+    return done;
+}
+
+static int
+WriteUserBuffer(int vaddr, int size, OpenFileId f_id)
+{
+    UserBuffer buffer(kernel->currentThread->space, vaddr, size, FALSE);
+    int done = 0;
+
+    if (!buffer.IsValid())
+	return -1;
+    for (int i = 0; i < buffer.NumSpans(); i++) {
+	int n = SysWrite(buffer.SpanStart(i), buffer.SpanLength(i), f_id);
+
+	if (n < 0)
+	    return (done > 0) ? done : n;
+	done += n;
+	if (n < buffer.SpanLength(i))
+	    break;
+    }
+    return done;
+}
+
+//----------------------------------------------------------------------
+// System call handlers
+// 	One for each system call.  "arg" holds the arguments, from r4 up
+//	(as many as the handler was registered with); the value returned
+//	is put back in r2 if the handler was registered as returning one.
+//	The PC has already been advanced past the syscall instruction.
+//----------------------------------------------------------------------
+
+static int
+HandleHalt(int *arg)
+{
+    DEBUG(dbgSys, "Shutdown, initiated by user program.\n");
+    SysHalt();
+
+    // the code below will not be executed in normal condition.
+    // Because SysHalt will delete kernel after finish executing.
+    cout<<"in exception\n";
+    ASSERTNOTREACHED();
+    return 0;
+}
+
+static int
+HandleExit(int *arg)
+{
+    DEBUG(dbgAddr, "Program exit\n");
+    cout << "return value:" << arg[0] << endl;
+    kernel->currentThread->Finish();
+    ASSERTNOTREACHED();
+    return 0;
+}
+
+static int
+HandlePrintInt(int *arg)
+{
+    SysPrintInt(arg[0]);
+    return 0;
+}
+
+static int
+HandleMessage(int *arg)
+{
+    char msg[MaxUserString];
+
+    DEBUG(dbgSys, "Message received.\n");
+    if (kernel->currentThread->space->ReadString((unsigned int)arg[0], 
+						msg, MaxUserString))
+	cout << msg << endl;
+    SysHalt();
+    ASSERTNOTREACHED();
+    return 0;
+}
+
+static int
+HandleCreate(int *arg)
+{
+    char filename[MaxUserString];
+
+    if (!kernel->currentThread->space->ReadString((unsigned int)arg[0], 
+						filename, MaxUserString))
+	return 0;
+    return SysCreate(filename);
+}
+
+static int
+HandleOpen(int *arg)
+{
+    char filename[MaxUserString];
+
+    if (!kernel->currentThread->space->ReadString((unsigned int)arg[0], 
+						filename, MaxUserString))
+	return -1;
+    return SysOpen(filename);
+}
+
+static int
+HandleRead(int *arg)
+{
+    return ReadUserBuffer(arg[0], arg[1], (OpenFileId) arg[2]);
+}
+
+static int
+HandleWrite(int *arg)
+{
+    return WriteUserBuffer(arg[0], arg[1], (OpenFileId) arg[2]);
+}
+
+static int
+HandleClose(int *arg)
+{
+    return SysClose((OpenFileId) arg[0]);
+}
+
+static int
+HandleAdd(int *arg)
+{
+    int result;
+
+    DEBUG(dbgSys, "Add " << arg[0] << " + " << arg[1] << "\n");
+    result = SysAdd(arg[0], arg[1]);
+    DEBUG(dbgSys, "Add returning with " << result << "\n");
+    cout << "result is " << result << "\n";	
+    return result;
+}
+
+static int
+HandleFork(int *arg)
+{
+    // the child starts with our registers, past the call
+    return SysFork();
+}
+
+static int
+HandleMmap(int *arg)
+{
+    return SysMmap((OpenFileId) arg[0], arg[1], arg[2]);
+}
+
+static int
+HandleMunmap(int *arg)
+{
+    return SysMunmap(arg[0]);
+}
+
+static int
+HandleCheckpoint(int *arg)
+{
+    // the PC is already past the call, so a restored program carries
+    // on after it
+    return SysCheckpoint();
+}
+
+//----------------------------------------------------------------------
+// The system call table
+//----------------------------------------------------------------------
+
+typedef int (*SyscallHandler)(int *arg);
+
+class SyscallEntry {
+  public:
+    const char *name;		// for debugging and Statistics
+    SyscallHandler handler;	// NULL if the code isn't a system call
+    int numArgs;		// how many of r4..r7 to pass
+    bool returnsValue;		// put the handler's result in r2?
+};
+
+static SyscallEntry syscallTable[NumSyscallCodes];
+static bool syscallTableReady = FALSE;
+
+//----------------------------------------------------------------------
+// Register
+// 	Enter a system call in the table.
+//----------------------------------------------------------------------
+
+static void
+Register(int code, const char *name, SyscallHandler handler, int numArgs, 
+							bool returnsValue)
+{
+    ASSERT((code >= 0) && (code < NumSyscallCodes));
+    ASSERT(numArgs <= 4);
+    syscallTable[code].name = name;
+    syscallTable[code].handler = handler;
+    syscallTable[code].numArgs = numArgs;
+    syscallTable[code].returnsValue = returnsValue;
+}
+
+//----------------------------------------------------------------------
+// RegisterSyscalls
+// 	Fill in the system call table, the first time a user program
+//	traps.  To add a system call, write its handler above and
+//	register it here.
+//----------------------------------------------------------------------
+
+static void
+RegisterSyscalls()
+{
+    Register(SC_Halt, "Halt", HandleHalt, 0, FALSE);
+    Register(SC_Exit, "Exit", HandleExit, 1, FALSE);
+    Register(SC_Create, "Create", HandleCreate, 1, TRUE);
+    Register(SC_Open, "Open", HandleOpen, 1, TRUE);
+    Register(SC_Read, "Read", HandleRead, 3, TRUE);
+    Register(SC_Write, "Write", HandleWrite, 3, TRUE);
+    Register(SC_Close, "Close", HandleClose, 1, TRUE);
+    Register(SC_Checkpoint, "Checkpoint", HandleCheckpoint, 0, TRUE);
+    Register(SC_Fork, "Fork", HandleFork, 0, TRUE);
+    Register(SC_Mmap, "Mmap", HandleMmap, 3, TRUE);
+    Register(SC_Munmap, "Munmap", HandleMunmap, 1, TRUE);
+    Register(SC_Add, "Add", HandleAdd, 2, TRUE);
+    Register(SC_MSG, "MSG", HandleMessage, 1, FALSE);
+    Register(SC_PrintInt, "PrintInt", HandlePrintInt, 1, FALSE);
+    syscallTableReady = TRUE;
+}
+
+//----------------------------------------------------------------------
+// SyscallName
+// 	Return the name system call "code" is registered under, or NULL
+//	if it isn't a system call.  The counts may have been restored
+//	from a checkpoint before any system call was made, so fill in the
+//	table first if need be.
+//----------------------------------------------------------------------
+
+const char *
+SyscallName(int code)
+{
+    if (!syscallTableReady)
+	RegisterSyscalls();
+    if ((code < 0) || (code >= NumSyscallCodes))
+	return NULL;
+    return syscallTable[code].name;
+}
+
 //----------------------------------------------------------------------
 // ExceptionHandler
 // 	Entry point into the Nachos kernel.  Called when a user program
@@ -41,8 +305,15 @@
 //
 //	The result of the system call, if any, must be put back into r2. 
 //
-// If you are handling a system call, don't forget to increment the pc
-// before returning. (Or else you'll loop making the same system call forever!)
+//	The arguments are decoded, the PC is advanced past the syscall
+//	(or else we'd loop making the same system call forever!) and the
+//	result is stored here, once for every system call; the handlers
+//	only do the work.  Each call, and the simulated time until it
+//	returns, is counted in Statistics.
+//
+//	A page fault leaves the PC alone, so the instruction that faulted
+//	is tried again once its page is in memory; so does a write to a
+//	read-only page, once it has been copied (see AddrSpace::CopyOnWrite).
 //
 //	"which" is the kind of exception.  The list of possible exceptions 
 //	is in machine.h.
@@ -55,175 +326,66 @@
 // 2015/10/4 : add SC_Close case to close the file 
 // 2015/10/4 : add SC_Read case to do read file task
 // 2015/12/5 : add addr  translation
+// 2026/10/17: SC_Read invalidates decoded instructions of the buffer pages
+// 2026/10/17: add SC_Checkpoint case to save the simulation state
+// 2026/10/17: pass user buffers and strings a page at a time, so they
+//             may cross into frames that are not contiguous
+// 2026/10/17: add PageFaultException case, to page in on demand
+// 2026/10/17: with a TLB, a PageFaultException is a TLB miss: refill it
+// 2026/10/17: dispatch system calls through a table, with one return path,
+//             counting them and their time in Statistics
+// 2026/10/17: add SC_Fork case, and copy shared pages on a ReadOnlyException
+// 2026/10/17: add SC_Mmap and SC_Munmap cases; a page fault outside the
+//             address space (say, in no mapping) is an AddressErrorException
+// 2026/10/17: add SyscallName(), so Statistics prints system calls by name
 // end Record ----------------------------------------------------
 
 void
 ExceptionHandler(ExceptionType which)
 {
-    int type = kernel->machine->ReadRegister(2);
-	int val;
-    int status, exit, threadID, programID;
-	DEBUG(dbgSys, "Received Exception " << which << " type: " << type << "\n");
-    switch (which) {
-    case SyscallException:
-      	switch(type) {
-      	case SC_Halt:
-			DEBUG(dbgSys, "Shutdown, initiated by user program.\n");
-            SysHalt();
-
-            // the code below will not be executed in normal condition.
-            // Because SysHalt will delete kernel after finish executing.
-                cout<<"in exception\n";
-			ASSERTNOTREACHED();
-			break;
-        case SC_PrintInt:
-            // read arg from reg[4]
-            SysPrintInt((int)kernel->machine->ReadRegister(4));
-            // fetch next instruction
-			kernel->machine->WriteRegister(PrevPCReg, kernel->machine->ReadRegister(PCReg));
-			kernel->machine->WriteRegister(PCReg, kernel->machine->ReadRegister(PCReg) + 4);
-			kernel->machine->WriteRegister(NextPCReg, kernel->machine->ReadRegister(PCReg)+4);
-            return;
-            ASSERTNOTREACHED();
-            break;
-		case SC_MSG:
-			DEBUG(dbgSys, "Message received.\n");
-			val = kernel->machine->ReadRegister(4);
-			{
-			unsigned int pa;
-			char *msg;
-            kernel->currentThread->space->Translate((unsigned int)val, &pa, 0);
-			msg = &(kernel->machine->mainMemory[pa]);
-			cout << msg << endl;
-			}
-			SysHalt();
-			ASSERTNOTREACHED();
-			break;
-		case SC_Create:
-			val = kernel->machine->ReadRegister(4);
-			{
-			unsigned int pa;
-            char *filename;
-            kernel->currentThread->space->Translate((unsigned int)val, &pa, 0);
-            filename = &(kernel->machine->mainMemory[pa]);
-			//cout << filename << endl;
-			status = SysCreate(filename);
-			kernel->machine->WriteRegister(2, (int) status);
-			}
-			kernel->machine->WriteRegister(PrevPCReg, kernel->machine->ReadRegister(PCReg));
-			kernel->machine->WriteRegister(PCReg, kernel->machine->ReadRegister(PCReg) + 4);
-			kernel->machine->WriteRegister(NextPCReg, kernel->machine->ReadRegister(PCReg)+4);
-			return;
-			ASSERTNOTREACHED();
-            break;
-      	case SC_Open:
-            val = kernel->machine->ReadRegister(4);
-            {
-            // address translation
-			unsigned int pa;
-            char *filename;
-            OpenFileId f_id;
-            kernel->currentThread->space->Translate((unsigned int)val, &pa, 0);
-            filename = &(kernel->machine->mainMemory[pa]);
-            f_id = SysOpen(filename);
-            kernel->machine->WriteRegister(2, (OpenFileId) f_id);
-            }
-			kernel->machine->WriteRegister(PrevPCReg, kernel->machine->ReadRegister(PCReg));
-			kernel->machine->WriteRegister(PCReg, kernel->machine->ReadRegister(PCReg) + 4);
-			kernel->machine->WriteRegister(NextPCReg, kernel->machine->ReadRegister(PCReg)+4);
-            return;
-            ASSERTNOTREACHED();
-            break;
-        case SC_Write:
-            val = kernel->machine->ReadRegister(4);
-            {
-			    unsigned int pa;
-                char *buffer;
-                int   size = (int) kernel->machine->ReadRegister(5);
-                OpenFileId f_id = (int) kernel->machine->ReadRegister(6);
-                kernel->currentThread->space->Translate((unsigned int)val, &pa, 0);
-                buffer = &(kernel->machine->mainMemory[pa]);
-                
-                status = SysWrite(buffer, size, f_id);
-                kernel->machine->WriteRegister(2, (int) status);
-            }
-			kernel->machine->WriteRegister(PrevPCReg, kernel->machine->ReadRegister(PCReg));
-			kernel->machine->WriteRegister(PCReg, kernel->machine->ReadRegister(PCReg) + 4);
-			kernel->machine->WriteRegister(NextPCReg, kernel->machine->ReadRegister(PCReg)+4);
-            return;
-            ASSERTNOTREACHED();
-            break;
-        case SC_Read:
-            val = kernel->machine->ReadRegister(4);
-            {
-			    unsigned int pa;
-                char *buffer;
-                int   size = (int) kernel->machine->ReadRegister(5);
-                OpenFileId f_id = (int) kernel->machine->ReadRegister(6);
-                kernel->currentThread->space->Translate((unsigned int)val, &pa, 0);
-                buffer = &(kernel->machine->mainMemory[pa]);
-                
-                status = SysRead(buffer, size, f_id);
-                kernel->machine->WriteRegister(2, (int) status);
-            }
-			kernel->machine->WriteRegister(PrevPCReg, kernel->machine->ReadRegister(PCReg));
-			kernel->machine->WriteRegister(PCReg, kernel->machine->ReadRegister(PCReg) + 4);
-			kernel->machine->WriteRegister(NextPCReg, kernel->machine->ReadRegister(PCReg)+4);
-            return;
-            ASSERTNOTREACHED();
-            break;
-        case SC_Close:
-            {
-            OpenFileId f_id = (int) kernel->machine->ReadRegister(4);
-            
-            status = SysClose(f_id);
-            kernel->machine->WriteRegister(2, (int) status);
-			}
-            kernel->machine->WriteRegister(PrevPCReg, kernel->machine->ReadRegister(PCReg));
-			kernel->machine->WriteRegister(PCReg, kernel->machine->ReadRegister(PCReg) + 4);
-			kernel->machine->WriteRegister(NextPCReg, kernel->machine->ReadRegister(PCReg)+4);
-            return;
-            ASSERTNOTREACHED();
-            break;
-        case SC_Add:
-			DEBUG(dbgSys, "Add " << kernel->machine->ReadRegister(4) << " + " << kernel->machine->ReadRegister(5) << "\n");
-			/* Process SysAdd Systemcall*/
-			int result;
-			result = SysAdd(/* int op1 */(int)kernel->machine->ReadRegister(4),
-			/* int op2 */(int)kernel->machine->ReadRegister(5));
-			DEBUG(dbgSys, "Add returning with " << result << "\n");
-			/* Prepare Result */
-			kernel->machine->WriteRegister(2, (int)result);	
-			/* Modify return point */
-			{
-	  		/* set previous programm counter (debugging only)*/
-	  		kernel->machine->WriteRegister(PrevPCReg, kernel->machine->ReadRegister(PCReg));
-	  			
-			/* set programm counter to next instruction (all Instructions are 4 byte wide)*/
-	  		kernel->machine->WriteRegister(PCReg, kernel->machine->ReadRegister(PCReg) + 4);
-	  
-	 		/* set next programm counter for brach execution */
-	 		kernel->machine->WriteRegister(NextPCReg, kernel->machine->ReadRegister(PCReg)+4);
-			}
-			cout << "result is " << result << "\n";	
-			return;	
-			ASSERTNOTREACHED();
-            break;
-		case SC_Exit:
-			DEBUG(dbgAddr, "Program exit\n");
-            val=kernel->machine->ReadRegister(4);
-            cout << "return value:" << val << endl;
-			kernel->currentThread->Finish();
-            break;
-      	default:
-			cerr << "Unexpected system call " << type << "\n";
-			break;
-		}
-		break;
-	default:
-		cerr << "Unexpected user mode exception " << (int)which << "\n";
-		break;
+    Machine *machine = kernel->machine;
+    int type = machine->ReadRegister(2);
+    SyscallEntry *entry;
+    int arg[4], result, start;
+
+    if (which == PageFaultException) {	// retried on return
+	unsigned int vaddr = (unsigned int) machine->ReadRegister(BadVAddrReg);
+
+	if (machine->tlb == NULL) {
+	    if (kernel->currentThread->space->PageIn(vaddr))
+		return;
+	} else if (kernel->currentThread->space->RefillTLB(vaddr))
+	    return;
+	which = AddressErrorException;	// not a page of ours
+    } else if (which == ReadOnlyException) {	// retried on return
+	unsigned int vaddr = (unsigned int) machine->ReadRegister(BadVAddrReg);
+
+	if (kernel->currentThread->space->CopyOnWrite(vaddr))
+	    return;
     }
-    ASSERTNOTREACHED();
-}
+    if (which != SyscallException) {
+	cerr << "Unexpected user mode exception " << (int)which << "\n";
+	ASSERTNOTREACHED();
+    }
+    if (!syscallTableReady)
+	RegisterSyscalls();
+    if ((type < 0) || (type >= NumSyscallCodes) || 
+				(syscallTable[type].handler == NULL)) {
+	cerr << "Unexpected system call " << type << "\n";
+	ASSERTNOTREACHED();
+    }
+    entry = &syscallTable[type];
+    DEBUG(dbgSys, "Received syscall " << entry->name << " type: " << type);
 
+    for (int i = 0; i < entry->numArgs; i++)
+	arg[i] = machine->ReadRegister(4 + i);
+    kernel->stats->numSyscalls[type]++;
+    start = kernel->stats->totalTicks;
+
+    machine->AdvancePC();		// return past the syscall
+    result = (*entry->handler)(arg);
+    if (entry->returnsValue)
+	machine->WriteRegister(2, result);
+
+    kernel->stats->syscallTicks[type] += kernel->stats->totalTicks - start;
+}
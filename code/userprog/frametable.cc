@@ -0,0 +1,352 @@
+// frametable.cc
+//	Routines to hand out the physical page frames of main memory:
+//	see frametable.h.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "frametable.h"
+#include "addrspace.h"
+#include "synch.h"
+#include "tlbmanager.h"
+#include "main.h"
+#include "debug.h"
+
+// How the text page cache finds a frame: by a key made from the ID of
+// the executable and the page number.
+
+static int
+TextKey(int textId, int virtualPage)
+{
+    ASSERT((virtualPage >= 0) && (virtualPage < 0x10000));
+    return (textId << 16) | virtualPage;
+}
+
+static int
+TextKeyOf(FrameInfo *info)
+{
+    return info->textKey;
+}
+
+static unsigned
+HashTextKey(int key)
+{
+    return (unsigned) (key * 31 + (key >> 16));
+}
+
+//----------------------------------------------------------------------
+// FrameTable::FrameTable
+// 	Initialize the frame table, with every frame free, to page out
+//	pages by the replacement policy "kind".
+//----------------------------------------------------------------------
+
+FrameTable::FrameTable(ReplacementKind kind)
+{
+    frames = new FrameInfo[NumPhysPages];
+    for (int i = 0; i < NumPhysPages; i++) {
+	frames[i].state = FrameFree;
+	frames[i].owner = NULL;
+	frames[i].virtualPage = -1;
+	frames[i].pinCount = 0;
+	frames[i].refCount = 0;
+	frames[i].sharers = NULL;
+	frames[i].textKey = -1;
+    }
+    firstFree = -1;
+    numFree = 0;
+    for (int i = NumPhysPages - 1; i >= 0; i--)	// frame 0 first
+	PushFree(i);
+    switch (kind) {
+      case FifoReplacement:
+	policy = new FifoPolicy(this);
+	break;
+      case ClockReplacement:
+	policy = new ClockPolicy(this);
+	break;
+      case AgingReplacement:
+	policy = new AgingPolicy(this);
+	break;
+      case WSClockReplacement:
+	policy = new WSClockPolicy(this);
+	break;
+      default:
+	ASSERTNOTREACHED();
+    }
+    DEBUG(dbgAddr, "Page replacement policy: " << policy->Name());
+    lock = new Lock("frame table");
+    textPages = new HashTable<int, FrameInfo *>(TextKeyOf, HashTextKey);
+    textFiles = new List<char *>;
+}
+
+//----------------------------------------------------------------------
+// FrameTable::~FrameTable
+// 	De-allocate the frame table.
+//----------------------------------------------------------------------
+
+FrameTable::~FrameTable()
+{
+    for (int i = 0; i < NumPhysPages; i++)
+	ForgetText(i);
+    while (!textFiles->IsEmpty())
+	delete [] textFiles->RemoveFront();
+    delete textPages;
+    delete textFiles;
+    delete policy;
+    delete lock;
+    delete [] frames;
+}
+
+//----------------------------------------------------------------------
+// FrameTable::Acquire, FrameTable::Release
+// 	Take and give up the right to page.
+//----------------------------------------------------------------------
+
+void
+FrameTable::Acquire()
+{
+    lock->Acquire();
+}
+
+void
+FrameTable::Release()
+{
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// FrameTable::Allocate
+// 	Find a frame for page "virtualPage" of "owner".  Take a free one
+//	if there is one; otherwise page out the page in the frame chosen
+//	by the replacement policy, which may mean waiting for the disk.
+//	The frame is returned busy: the caller fills it, then calls Map.
+//	The policy is told of the fault by the caller (see Fault), not
+//	here, since one fault may take several frames.
+//----------------------------------------------------------------------
+
+int
+FrameTable::Allocate(AddrSpace *owner, int virtualPage)
+{
+    int frame;
+
+    ASSERT(lock->IsHeldByCurrentThread());
+    if (firstFree >= 0) {
+	frame = firstFree;
+	RemoveFree(frame);
+    } else {
+	frame = policy->ChooseVictim();
+	if (frame < 0) {
+	    cerr << "No frame can be paged out: all are pinned or shared\n";
+	    Abort();
+	}
+	DEBUG(dbgAddr, "Paging out page " << frames[frame].virtualPage <<
+				" from frame " << frame);
+	ForgetText(frame);
+	frames[frame].state = FrameBusy;
+	frames[frame].owner->PageOut(frames[frame].virtualPage);
+    }
+    frames[frame].state = FrameBusy;
+    frames[frame].owner = owner;
+    frames[frame].virtualPage = virtualPage;
+    frames[frame].refCount = 1;
+    return frame;
+}
+
+//----------------------------------------------------------------------
+// FrameTable::Map
+// 	The busy "frame" now holds its page, and may be paged out.
+//----------------------------------------------------------------------
+
+void
+FrameTable::Map(int frame)
+{
+    ASSERT(frames[frame].state == FrameBusy);
+    frames[frame].state = FrameInUse;
+    policy->Mapped(frame);
+}
+
+//----------------------------------------------------------------------
+// FrameTable::Reserve
+// 	Mark "frame" as holding page "virtualPage" of "owner", without
+//	filling it: its contents were restored with the rest of mainMemory.
+//----------------------------------------------------------------------
+
+void
+FrameTable::Reserve(int frame, AddrSpace *owner, int virtualPage)
+{
+    ASSERT(frames[frame].state == FrameFree);
+    RemoveFree(frame);
+    frames[frame].state = FrameInUse;
+    frames[frame].owner = owner;
+    frames[frame].virtualPage = virtualPage;
+    frames[frame].refCount = 1;
+    policy->Mapped(frame);
+}
+
+//----------------------------------------------------------------------
+// FrameTable::Share
+// 	Note that "frame" also holds page "virtualPage" of "space", which
+//	maps it read-only, as its owner does.  Until all but one of them
+//	have copied the page, the frame can't be paged out.
+//----------------------------------------------------------------------
+
+void
+FrameTable::Share(int frame, AddrSpace *space, int virtualPage)
+{
+    FrameSharer *sharer = new FrameSharer;
+
+    ASSERT(frames[frame].state == FrameInUse);
+    sharer->space = space;
+    sharer->virtualPage = virtualPage;
+    sharer->next = frames[frame].sharers;
+    frames[frame].sharers = sharer;
+    frames[frame].refCount++;
+}
+
+//----------------------------------------------------------------------
+// FrameTable::PageEntry
+// 	Return where the use and dirty bits of the page in "frame" are,
+//	bringing them up to date with the TLB first, if there is one.
+//----------------------------------------------------------------------
+
+TranslationEntry *
+FrameTable::PageEntry(int frame)
+{
+    AddrSpace *owner = frames[frame].owner;
+
+    ASSERT(frames[frame].state == FrameInUse);
+    if (owner->Asid() >= 0)
+	kernel->tlbManager->Sync(owner->Asid(), frames[frame].virtualPage,
+									FALSE);
+    return owner->PageEntry(frames[frame].virtualPage);
+}
+
+//----------------------------------------------------------------------
+// FrameTable::Free
+// 	"space" is done with the page in "frame".  If the frame is shared,
+//	drop "space" from those sharing it (a sharer takes over from the
+//	owner, if need be); otherwise give the frame back.
+//----------------------------------------------------------------------
+
+void
+FrameTable::Free(int frame, AddrSpace *space)
+{
+    FrameInfo *info = &frames[frame];
+    FrameSharer **link, *sharer;
+
+    ASSERT(info->state == FrameInUse);
+    if (info->refCount > 1) {
+	if (info->owner == space) {
+	    sharer = info->sharers;
+	    info->owner = sharer->space;
+	    info->virtualPage = sharer->virtualPage;
+	    info->sharers = sharer->next;
+	} else {
+	    for (link = &info->sharers; (*link)->space != space; 
+							link = &(*link)->next)
+		ASSERT((*link)->next != NULL);
+	    sharer = *link;
+	    *link = sharer->next;
+	}
+	delete sharer;
+	info->refCount--;
+	return;
+    }
+    ASSERT(info->owner == space);
+    ASSERT(info->pinCount == 0);
+    ForgetText(frame);
+    info->state = FrameFree;
+    info->owner = NULL;
+    info->virtualPage = -1;
+    info->refCount = 0;
+    PushFree(frame);
+}
+
+//----------------------------------------------------------------------
+// FrameTable::PushFree, FrameTable::RemoveFree
+// 	Put "frame" at the head of the free list, or take it off the list
+//	from wherever it is.
+//----------------------------------------------------------------------
+
+void
+FrameTable::PushFree(int frame)
+{
+    frames[frame].prevFree = -1;
+    frames[frame].nextFree = firstFree;
+    if (firstFree >= 0)
+	frames[firstFree].prevFree = frame;
+    firstFree = frame;
+    numFree++;
+}
+
+void
+FrameTable::RemoveFree(int frame)
+{
+    FrameInfo *info = &frames[frame];
+
+    ASSERT(info->state == FrameFree);
+    if (info->prevFree >= 0)
+	frames[info->prevFree].nextFree = info->nextFree;
+    else
+	firstFree = info->nextFree;
+    if (info->nextFree >= 0)
+	frames[info->nextFree].prevFree = info->prevFree;
+    numFree--;
+}
+
+//----------------------------------------------------------------------
+// FrameTable::TextId
+// 	Return the ID of the executable "fileName", giving it the next one
+//	if no address space has run it before.
+//----------------------------------------------------------------------
+
+int
+FrameTable::TextId(char *fileName)
+{
+    ListIterator<char *> iter(textFiles);
+    char *copy;
+    int id = 0;
+
+    for (; !iter.IsDone(); iter.Next(), id++)
+	if (strcmp(iter.Item(), fileName) == 0)
+	    return id;
+    copy = new char[strlen(fileName) + 1];
+    strcpy(copy, fileName);
+    textFiles->Append(copy);
+    return id;
+}
+
+//----------------------------------------------------------------------
+// FrameTable::FindText, FrameTable::EnterText, FrameTable::ForgetText
+// 	Look up, add and remove frames in the text page cache.
+//----------------------------------------------------------------------
+
+int
+FrameTable::FindText(int textId, int virtualPage)
+{
+    FrameInfo *info;
+
+    if (!textPages->Find(TextKey(textId, virtualPage), &info))
+	return -1;
+    ASSERT(info->state == FrameInUse);
+    return info - frames;
+}
+
+void
+FrameTable::EnterText(int frame, int textId, int virtualPage)
+{
+    ASSERT(frames[frame].state == FrameInUse);
+    ASSERT(frames[frame].textKey < 0);
+    frames[frame].textKey = TextKey(textId, virtualPage);
+    textPages->Insert(&frames[frame]);
+}
+
+void
+FrameTable::ForgetText(int frame)
+{
+    if (frames[frame].textKey < 0)
+	return;
+    textPages->Remove(frames[frame].textKey);
+    frames[frame].textKey = -1;
+}
@@ -0,0 +1,157 @@
+// frametable.h
+//	Data structures to keep track of the physical page frames of
+//	main memory, and which user program page each one holds.
+//
+//	User programs are paged in on demand: a page is given a frame the
+//	first time it is touched.  Free frames are kept on a list, so
+//	finding one takes the same time however big memory is; the frame
+//	freed last is handed out first.  When no frame is free, one is taken
+//	from some address space -- perhaps the faulting one -- which first
+//	writes the page out to swap if it has been changed (see
+//	AddrSpace::PageOut).
+//
+//	Which page is taken is up to a replacement policy (see replace.h),
+//	chosen on the command line.
+//
+//	A frame is "busy" while it is being filled or emptied; the thread
+//	doing so may wait for the disk, so other threads must leave the
+//	frame alone meanwhile.  Only one thread pages at a time, holding
+//	the frame table's lock.  A frame can also be "pinned", while the
+//	kernel reads or writes it on behalf of a system call; pinned
+//	frames are never taken.
+//
+//	After a Fork, a frame may hold a page of several address spaces,
+//	read-only in each, until they write it (see AddrSpace::Fork and
+//	AddrSpace::CopyOnWrite).  Shared frames are not taken either; one
+//	is only freed when the last address space sharing it frees it.
+//
+//	Pages of code (and read-only data) are shared the same way by
+//	every address space running the same executable: the frame table
+//	keeps a cache of the frames holding them, keyed by the executable
+//	and the page (see AddrSpace::PageIn).  A frame leaves the cache
+//	when it is freed, paged out, or made writable.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef FRAMETABLE_H
+#define FRAMETABLE_H
+
+#include "copyright.h"
+#include "utility.h"
+#include "debug.h"
+#include "machine.h"
+#include "replace.h"
+#include "hash.h"
+
+class AddrSpace;
+class Lock;
+
+// The states a frame can be in.
+
+enum FrameState { FrameFree, FrameInUse, FrameBusy };
+
+// Another address space with the page in a shared frame.
+
+class FrameSharer {
+  public:
+    AddrSpace *space;
+    int virtualPage;
+    FrameSharer *next;
+};
+
+// What the frame table knows about each frame.
+
+class FrameInfo {
+  public:
+    FrameState state;
+    AddrSpace *owner;		// the address space whose page it holds
+    int virtualPage;		// and which page that is
+    int pinCount;		// > 0 if the kernel is using the frame
+    int refCount;		// address spaces with the page in it
+    FrameSharer *sharers;	// the others besides "owner", if any
+    int textKey;		// where it is in the text page cache, or
+				// -1 if it isn't
+    int nextFree, prevFree;	// its neighbours on the free list, if it
+				// is free (-1 at the ends)
+};
+
+// The following class defines the frame table.
+
+class FrameTable {
+  public:
+    FrameTable(ReplacementKind kind);
+				// All frames start free; "kind" says
+				// which pages to page out
+    ~FrameTable();
+
+    void Acquire();		// Only one thread may page at a time
+    void Release();
+    void Fault() { policy->Fault(); }
+				// A page fault is being handled (once
+				// per fault, however many frames it
+				// takes).  The lock must be held.
+
+    int Allocate(AddrSpace *owner, int virtualPage);
+				// Return a busy frame to hold
+				// "virtualPage", paging something out
+				// if need be.  The lock must be held.
+    void Map(int frame);	// The frame has been filled, and mapped
+    void Reserve(int frame, AddrSpace *owner, int virtualPage);
+				// Claim "frame", for a page restored
+				// from a checkpoint
+    void Share(int frame, AddrSpace *space, int virtualPage);
+				// "frame" holds "virtualPage" of "space"
+				// too, copy-on-write
+    int RefCount(int frame) { return frames[frame].refCount; }
+    void Free(int frame, AddrSpace *space);
+				// "space" no longer needs the page in
+				// "frame"
+    int NumFree() { return numFree; }
+
+    int TextId(char *fileName);	// An ID for the executable "fileName",
+				// the same for every address space
+				// running it
+    int FindText(int textId, int virtualPage);
+				// The frame holding "virtualPage" of
+				// executable "textId", or -1 if none does
+    void EnterText(int frame, int textId, int virtualPage);
+				// The mapped "frame" holds that page, for
+				// others running the executable to share
+    void ForgetText(int frame);	// It doesn't any more
+
+    void Pin(int frame) { frames[frame].pinCount++; }
+    void Unpin(int frame) {
+	ASSERT(frames[frame].pinCount > 0);
+	frames[frame].pinCount--;
+    }
+
+    // For the replacement policy
+
+    bool IsMapped(int frame) { return frames[frame].state == FrameInUse; }
+    bool CanPageOut(int frame) {
+	return (frames[frame].state == FrameInUse) && 
+		(frames[frame].pinCount == 0) && (frames[frame].refCount == 1);
+    }
+    TranslationEntry *PageEntry(int frame);
+				// The page table entry of the page in
+				// "frame", which must be mapped
+    const char *PolicyName() { return policy->Name(); }
+
+  private:
+    void PushFree(int frame);	// Put "frame" on the free list
+    void RemoveFree(int frame);	// Take it off
+
+    FrameInfo *frames;		// one for each of the NumPhysPages
+    int firstFree;		// head of the free list, or -1 if no
+				// frame is free
+    int numFree;
+    ReplacementPolicy *policy;	// chooses frames to page out
+    Lock *lock;			// held while paging
+    HashTable<int, FrameInfo *> *textPages;
+				// the frames holding text pages, by key
+    List<char *> *textFiles;	// the executables, in order of ID
+};
+
+#endif // FRAMETABLE_H
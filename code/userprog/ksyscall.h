@@ -15,6 +15,9 @@
 // 2015/10/4 : Implement SysClose() 
 // 2015/10/4 : Implement SysRead() 
 // 2015/10/8 : modify PrintInt flow
+// 2026/10/17 : Implement SysCheckpoint()
+// 2026/10/17 : Implement SysFork()
+// 2026/10/17 : Implement SysMmap() and SysMunmap()
 // end Record ----------------------------------------------------
 
 #ifndef __USERPROG_KSYSCALL_H__ 
@@ -69,4 +72,24 @@ void SysPrintInt(int number)
     kernel->interrupt->PrintInt(number);
 }
 
+int SysCheckpoint()
+{
+    return kernel->Checkpoint();
+}
+
+int SysFork()
+{
+    return kernel->Fork();
+}
+
+int SysMmap(OpenFileId id, int offset, int length)
+{
+    return kernel->currentThread->space->MapFile(id, offset, length);
+}
+
+int SysMunmap(int addr)
+{
+    return kernel->currentThread->space->UnmapFile(addr) ? 0 : -1;
+}
+
 #endif /* ! __USERPROG_KSYSCALL_H__ */
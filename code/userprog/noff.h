@@ -5,6 +5,9 @@
  *	code (read-only), initialized data, and unitialized data
  */
 
+#ifndef NOFF_H
+#define NOFF_H
+
 #define NOFFMAGIC	0xbadfad 	/* magic number denoting Nachos 
 					 * object code file 
 					 */
@@ -26,3 +29,28 @@ typedef struct noffHeader {
 				 * should be zero'ed before use 
 				 */
 } NoffHeader;
+
+/* A NOFF file may also have a symbol table, after the last segment: 
+ * a NoffSymbolHeader, then "numSymbols" NoffSymbols (one per procedure),
+ * then "stringSize" bytes of null-terminated procedure names.  Nachos 
+ * only uses it to say where a program spends its time (see 
+ * machine/profile.h); a file without one just ends after its segments.
+ * Like the NoffHeader, it is always little-endian.
+ */
+
+#define NOFFSYMMAGIC	0xbadf00d	/* magic number denoting a NOFF
+					 * symbol table
+					 */
+
+typedef struct noffSymbolHeader {
+   int symMagic;		/* should be NOFFSYMMAGIC */
+   int numSymbols;		/* number of NoffSymbols that follow */
+   int stringSize;		/* bytes of names after the NoffSymbols */
+} NoffSymbolHeader;
+
+typedef struct noffSymbol {
+   int address;			/* virtual address of the procedure */
+   int name;			/* offset of its name in the names */
+} NoffSymbol;
+
+#endif /* NOFF_H */
@@ -0,0 +1,207 @@
+// replace.cc
+//	Routines to choose which page to page out, for each of the
+//	page replacement policies: see replace.h.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "replace.h"
+#include "frametable.h"
+#include "main.h"
+
+//----------------------------------------------------------------------
+// FifoPolicy::FifoPolicy
+// 	Initialize FIFO replacement: no frame has been filled yet.
+//----------------------------------------------------------------------
+
+FifoPolicy::FifoPolicy(FrameTable *frames) : ReplacementPolicy(frames)
+{
+    loadedAt = new int[NumPhysPages];
+    for (int i = 0; i < NumPhysPages; i++)
+	loadedAt[i] = 0;
+    numLoaded = 0;
+}
+
+//----------------------------------------------------------------------
+// FifoPolicy::ChooseVictim
+// 	Return the frame we may take that was filled longest ago.
+//----------------------------------------------------------------------
+
+int
+FifoPolicy::ChooseVictim()
+{
+    int victim = -1;
+
+    for (int i = 0; i < NumPhysPages; i++)
+	if (frameTable->CanPageOut(i) &&
+			((victim < 0) || (loadedAt[i] < loadedAt[victim])))
+	    victim = i;
+    return victim;
+}
+
+//----------------------------------------------------------------------
+// ClockPolicy::ClockPolicy
+// 	Initialize second-chance replacement, with the hand just before
+//	the first frame.
+//----------------------------------------------------------------------
+
+ClockPolicy::ClockPolicy(FrameTable *frames) : ReplacementPolicy(frames)
+{
+    hand = NumPhysPages - 1;
+}
+
+//----------------------------------------------------------------------
+// ClockPolicy::ChooseVictim
+// 	Move the hand on to the next frame we may take whose page has not
+//	been used since the hand last passed it.  Twice round is enough:
+//	the first time round clears every use bit.
+//----------------------------------------------------------------------
+
+int
+ClockPolicy::ChooseVictim()
+{
+    TranslationEntry *entry;
+
+    for (int i = 0; i < 2 * NumPhysPages; i++) {
+	hand = (hand + 1) % NumPhysPages;
+	if (!frameTable->CanPageOut(hand))
+	    continue;
+	entry = frameTable->PageEntry(hand);
+	if (!entry->use)
+	    return hand;
+	entry->use = FALSE;		// second chance
+    }
+    return -1;
+}
+
+//----------------------------------------------------------------------
+// AgingPolicy::AgingPolicy
+// 	Initialize aging replacement, with every counter zero.
+//----------------------------------------------------------------------
+
+AgingPolicy::AgingPolicy(FrameTable *frames) : ReplacementPolicy(frames)
+{
+    age = new unsigned int[NumPhysPages];
+    for (int i = 0; i < NumPhysPages; i++)
+	age[i] = 0;
+    hand = NumPhysPages - 1;
+}
+
+//----------------------------------------------------------------------
+// AgingPolicy::Fault
+// 	Age the counter of every frame in use (pinned or not), moving
+//	its page's use bit into the top of the counter.
+//----------------------------------------------------------------------
+
+void
+AgingPolicy::Fault()
+{
+    TranslationEntry *entry;
+
+    for (int i = 0; i < NumPhysPages; i++) {
+	if (!frameTable->IsMapped(i))
+	    continue;
+	entry = frameTable->PageEntry(i);
+	age[i] >>= 1;
+	if (entry->use)
+	    age[i] |= 0x80000000;
+	entry->use = FALSE;
+    }
+}
+
+//----------------------------------------------------------------------
+// AgingPolicy::ChooseVictim
+// 	Return the frame we may take with the smallest counter.  The
+//	search starts one past where the last one did, so that frames
+//	whose counters are equal take turns.
+//----------------------------------------------------------------------
+
+int
+AgingPolicy::ChooseVictim()
+{
+    int victim = -1;
+    int frame;
+
+    hand = (hand + 1) % NumPhysPages;
+    for (int i = 0; i < NumPhysPages; i++) {
+	frame = (hand + i) % NumPhysPages;
+	if (frameTable->CanPageOut(frame) &&
+			((victim < 0) || (age[frame] < age[victim])))
+	    victim = frame;
+    }
+    return victim;
+}
+
+//----------------------------------------------------------------------
+// WSClockPolicy::WSClockPolicy
+// 	Initialize working-set clock replacement, with the hand just
+//	before the first frame.
+//----------------------------------------------------------------------
+
+WSClockPolicy::WSClockPolicy(FrameTable *frames) : ReplacementPolicy(frames)
+{
+    lastUsed = new int[NumPhysPages];
+    for (int i = 0; i < NumPhysPages; i++)
+	lastUsed[i] = 0;
+    hand = NumPhysPages - 1;
+}
+
+//----------------------------------------------------------------------
+// WSClockPolicy::Mapped
+// 	A page just paged in is about to be used.
+//----------------------------------------------------------------------
+
+void
+WSClockPolicy::Mapped(int frame)
+{
+    lastUsed[frame] = kernel->stats->totalTicks;
+}
+
+//----------------------------------------------------------------------
+// WSClockPolicy::ChooseVictim
+// 	Move the hand round the frames we may take, clearing use bits
+//	and noting the time, until it reaches a clean page that has not
+//	been used for WorkingSetWindow ticks.  Once round, with the use
+//	bits all cleared, is enough to find one if there is one.
+//
+//	Nachos can't write the dirty pages out in the background as the
+//	hand passes them, as real WSClock does, so if there is no clean
+//	old page, take the first dirty old page the hand passed (it is
+//	written out by AddrSpace::PageOut), or else the page that was
+//	last used longest ago.
+//----------------------------------------------------------------------
+
+int
+WSClockPolicy::ChooseVictim()
+{
+    int now = kernel->stats->totalTicks;
+    int oldDirty = -1, oldest = -1;
+    TranslationEntry *entry;
+
+    for (int i = 0; i < NumPhysPages; i++) {
+	hand = (hand + 1) % NumPhysPages;
+	if (!frameTable->CanPageOut(hand))
+	    continue;
+	entry = frameTable->PageEntry(hand);
+	if (entry->use) {		// in the working set
+	    entry->use = FALSE;
+	    lastUsed[hand] = now;
+	} else if (now - lastUsed[hand] > WorkingSetWindow) {
+	    if (!entry->dirty)
+		return hand;
+	    if (oldDirty < 0)
+		oldDirty = hand;
+	}
+	if ((oldest < 0) || (lastUsed[hand] < lastUsed[oldest]))
+	    oldest = hand;
+    }
+    if (oldDirty >= 0)
+	hand = oldDirty;
+    else if (oldest >= 0)
+	hand = oldest;
+    else
+	return -1;
+    return hand;
+}
@@ -0,0 +1,134 @@
+// replace.h
+//	Data structures for the policies that choose which page to page
+//	out when no physical page frame is free.
+//
+//	The frame table asks its policy for a victim among the frames it
+//	may take (in use, and not pinned), and tells it whenever a frame
+//	is filled, and whenever a page fault happens.  A policy
+//	looks at the use and dirty bits of the page in each frame (set by
+//	Machine::Translate and AddrSpace::Translate), and may clear the
+//	use bit; the caches of recent translations are flushed after
+//	every exception, so the next touch of the page sets it again.
+//
+//	The policy is chosen with "-pr fifo|clock|lru|wsclock".
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef REPLACE_H
+#define REPLACE_H
+
+#include "copyright.h"
+#include "utility.h"
+#include "machine.h"
+
+class FrameTable;
+
+// The policies there are to choose from.
+
+enum ReplacementKind { FifoReplacement,	// the page paged in longest ago
+		       ClockReplacement,	// second chance, by use bit
+		       AgingReplacement,	// least recently used, by
+						// counters aged at each fault
+		       WSClockReplacement	// clean pages outside the
+						// working set first
+};
+
+const int WorkingSetWindow = 5000;	// ticks since a page was last
+					// used, before WSClock considers
+					// it out of the working set
+
+// The following class defines the interface every policy provides.
+
+class ReplacementPolicy {
+  public:
+    ReplacementPolicy(FrameTable *frames) { frameTable = frames; }
+    virtual ~ReplacementPolicy() {}
+
+    virtual const char *Name() = 0;	// for printing
+    virtual int ChooseVictim() = 0;
+				// Return a frame the frame table may take,
+				// or -1 if there is none
+    virtual void Mapped(int frame) {}
+				// "frame" has just been filled
+    virtual void Fault() {}	// A page fault is about to be handled
+
+  protected:
+    FrameTable *frameTable;	// whose frames we choose among
+};
+
+// Page out the page that was paged in longest ago, whether or not it
+// has been used since.
+
+class FifoPolicy : public ReplacementPolicy {
+  public:
+    FifoPolicy(FrameTable *frames);
+    ~FifoPolicy() { delete [] loadedAt; }
+
+    const char *Name() { return "fifo"; }
+    int ChooseVictim();
+    void Mapped(int frame) { loadedAt[frame] = numLoaded++; }
+
+  private:
+    int *loadedAt;		// when each frame was last filled
+    int numLoaded;		// frames filled so far
+};
+
+// Sweep a hand round the frames, clearing the use bit of each page it
+// passes; page out the first page whose use bit is already clear.
+
+class ClockPolicy : public ReplacementPolicy {
+  public:
+    ClockPolicy(FrameTable *frames);
+
+    const char *Name() { return "clock"; }
+    int ChooseVictim();
+
+  private:
+    int hand;			// the last frame chosen
+};
+
+// Keep an aging counter for each frame: at every page fault, shift it
+// right, with the page's use bit shifted in at the top, and clear the
+// use bit.  Page out the page whose counter is smallest -- the one
+// least recently used, to within one fault.
+
+class AgingPolicy : public ReplacementPolicy {
+  public:
+    AgingPolicy(FrameTable *frames);
+    ~AgingPolicy() { delete [] age; }
+
+    const char *Name() { return "lru"; }
+    int ChooseVictim();
+    void Mapped(int frame) { age[frame] = 0; }
+    void Fault();
+
+  private:
+    unsigned int *age;		// for each frame
+    int hand;			// where the last search started, so
+				// ties are broken round robin
+};
+
+// Sweep a hand round the frames as ClockPolicy does, also noting when
+// each page was last seen used.  Page out the first page that has not
+// been used for WorkingSetWindow ticks and is clean; failing that, the
+// first such page that is dirty; failing that, the page least recently
+// seen used.
+
+class WSClockPolicy : public ReplacementPolicy {
+  public:
+    WSClockPolicy(FrameTable *frames);
+    ~WSClockPolicy() { delete [] lastUsed; }
+
+    const char *Name() { return "wsclock"; }
+    int ChooseVictim();
+    void Mapped(int frame);
+
+  private:
+    int *lastUsed;		// totalTicks when each page was
+				// last seen used
+    int hand;			// the last frame chosen
+};
+
+#endif // REPLACE_H
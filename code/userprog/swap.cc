@@ -0,0 +1,150 @@
+// swap.cc
+//	Routines to page user programs out to the disk, and back in:
+//	see swap.h.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "swap.h"
+#include "synchdisk.h"
+#include "machine.h"
+#include "debug.h"
+
+//----------------------------------------------------------------------
+// SwapArea::SwapArea
+// 	Divide the swap region of "disk" into page-sized slots, all free.
+//----------------------------------------------------------------------
+
+SwapArea::SwapArea(SynchDisk *disk)
+{
+    ASSERT(PageSize % SectorSize == 0);
+    this->disk = disk;
+    sectorsPerPage = PageSize / SectorSize;
+    slots = new Bitmap(NumSwapSectors / sectorsPerPage);
+    refCount = new int[NumSwapSectors / sectorsPerPage];
+    buffer = new char[SectorsPerTrack * SectorSize];
+}
+
+//----------------------------------------------------------------------
+// SwapArea::~SwapArea
+// 	De-allocate the swap area.  The disk is not ours to delete.
+//----------------------------------------------------------------------
+
+SwapArea::~SwapArea()
+{
+    delete slots;
+    delete [] refCount;
+    delete [] buffer;
+}
+
+//----------------------------------------------------------------------
+// SwapArea::Allocate, SwapArea::Mark, SwapArea::Share, SwapArea::Free
+// 	Keep track of which slots hold pages, and for how many address
+//	spaces.
+//----------------------------------------------------------------------
+
+int
+SwapArea::Allocate()
+{
+    int slot = slots->FindAndSet();
+
+    if (slot >= 0)
+	refCount[slot] = 1;
+    return slot;
+}
+
+void
+SwapArea::Mark(int slot)
+{
+    ASSERT(!slots->Test(slot));
+    slots->Mark(slot);
+    refCount[slot] = 1;
+}
+
+void
+SwapArea::Share(int slot)
+{
+    ASSERT(slots->Test(slot));
+    refCount[slot]++;
+}
+
+void
+SwapArea::Free(int slot)
+{
+    ASSERT(slots->Test(slot));
+    if (--refCount[slot] == 0)
+	slots->Clear(slot);
+}
+
+//----------------------------------------------------------------------
+// SwapArea::ReadPage, SwapArea::WritePage
+// 	Transfer a page between main memory and "slot", a sector at a
+//	time.  The calling thread waits until it is done.
+//----------------------------------------------------------------------
+
+void
+SwapArea::ReadPage(int slot, char *into)
+{
+    int sector = SwapFirstSector + slot * sectorsPerPage;
+
+    DEBUG(dbgAddr, "Reading swap slot " << slot);
+    for (int i = 0; i < sectorsPerPage; i++)
+	disk->ReadSector(sector + i, into + i * SectorSize);
+}
+
+//----------------------------------------------------------------------
+// SwapArea::ReadPages
+// 	Read the page in each of "slot"[0..count-1] into the matching
+//	"into", in slot order.  Pages in adjacent slots, as far as the
+//	end of a track, are read with one disk request into "buffer",
+//	and copied out from there.  The arrays are sorted in place.
+//----------------------------------------------------------------------
+
+void
+SwapArea::ReadPages(int *slot, char **into, int count)
+{
+    for (int i = 1; i < count; i++) {	// insertion sort: count is small
+	int s = slot[i];
+	char *page = into[i];
+	int j;
+
+	for (j = i; (j > 0) && (slot[j - 1] > s); j--) {
+	    slot[j] = slot[j - 1];
+	    into[j] = into[j - 1];
+	}
+	slot[j] = s;
+	into[j] = page;
+    }
+    for (int i = 0; i < count; ) {
+	int sector = SwapFirstSector + slot[i] * sectorsPerPage;
+	int room = SectorsPerTrack - (sector % SectorsPerTrack);
+	int run = 1;
+
+	if (room < sectorsPerPage) {	// the page goes onto the next track
+	    ReadPage(slot[i], into[i]);
+	    i++;
+	    continue;
+	}
+	while ((i + run < count) && (slot[i + run] == slot[i] + run) &&
+		((run + 1) * sectorsPerPage <= room))
+	    run++;
+	DEBUG(dbgAddr, "Reading swap slots " << slot[i] << " to " << 
+						slot[i] + run - 1);
+	disk->ReadSectors(sector, run * sectorsPerPage, buffer);
+	for (int j = 0; j < run; j++)
+	    bcopy(buffer + j * PageSize, into[i + j], PageSize);
+	i += run;
+    }
+}
+
+void
+SwapArea::WritePage(int slot, char *from)
+{
+    int sector = SwapFirstSector + slot * sectorsPerPage;
+
+    DEBUG(dbgAddr, "Writing swap slot " << slot);
+    for (int i = 0; i < sectorsPerPage; i++)
+	disk->WriteSector(sector + i, from + i * SectorSize);
+}
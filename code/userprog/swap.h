@@ -0,0 +1,77 @@
+// swap.h
+//	Data structures to keep the pages of user programs that have been
+//	paged out of main memory, in a region of the simulated disk.
+//
+//	The swap area is divided into slots of one page each; a page
+//	that is paged out dirty is written to a slot, and read back from
+//	it the next time it is needed.  Reading and writing go through
+//	SynchDisk, so a thread that pages waits for the disk (and is
+//	charged the seek and rotation time) like any other disk user.
+//
+//	A forked child shares its parent's slots (see AddrSpace::Fork): a
+//	slot is only free once every address space sharing it frees it,
+//	and a page in a shared slot is written to a slot of its own.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef SWAP_H
+#define SWAP_H
+
+#include "copyright.h"
+#include "utility.h"
+#include "bitmap.h"
+#include "disk.h"
+
+class SynchDisk;
+
+// Where the swap area is on the disk.  The stub file system keeps its
+// files in UNIX, so the whole disk is free for swapping; otherwise the
+// file system has the first half, and marks the second half in use
+// when it formats the disk (see FileSystem::FileSystem).
+
+#ifdef FILESYS_STUB
+const int SwapFirstSector = 0;
+#else
+const int SwapFirstSector = NumSectors / 2;
+#endif
+const int NumSwapSectors = NumSectors - SwapFirstSector;
+
+// The following class defines the swap area.
+
+class SwapArea {
+  public:
+    SwapArea(SynchDisk *disk);	// Swap to "disk", which must be
+				// initialized; all slots start free
+    ~SwapArea();
+
+    int Allocate();		// Return a free slot, or -1 if the
+				// swap area is full
+    void Mark(int slot);	// Claim "slot", for a page restored
+				// from a checkpoint
+    void Share(int slot);	// Another address space has the page
+				// in "slot" too
+    bool IsShared(int slot) { return refCount[slot] > 1; }
+    void Free(int slot);	// The page in "slot" is not needed (by
+				// one of the address spaces sharing it)
+
+    void ReadPage(int slot, char *into);
+				// Read the page in "slot" into "into",
+    void WritePage(int slot, char *from);
+				// or write the page at "from" to it
+    void ReadPages(int *slot, char **into, int count);
+				// Read the pages in "count" slots,
+				// those in adjacent slots on one track
+				// with a single disk request
+
+  private:
+    SynchDisk *disk;
+    int sectorsPerPage;		// disk sectors in a slot
+    Bitmap *slots;		// which slots hold pages
+    int *refCount;		// and how many address spaces have each
+    char *buffer;		// a track, for ReadPages; paging is
+				// one thread at a time (see FrameTable)
+};
+
+#endif // SWAP_H
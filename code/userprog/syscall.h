@@ -12,6 +12,9 @@
 
 // Record --------------------------------------------------------
 // 2015/10/1 : define PrintInt() to do console int output.
+// 2026/10/17 : define Checkpoint() to save the simulation state.
+// 2026/10/17 : define Fork() to copy the running program.
+// 2026/10/17 : define Mmap() and Munmap() to map files into memory.
 // end Record ----------------------------------------------------
 
 #ifndef SYSCALLS_H
@@ -38,6 +41,10 @@
 #define SC_ExecV	13
 #define SC_ThreadExit   14
 #define SC_ThreadJoin   15
+#define SC_Checkpoint   16
+#define SC_Fork         17
+#define SC_Mmap         18
+#define SC_Munmap       19
 #define SC_Add		42
 #define SC_MSG		100
 #define SC_PrintInt 101
@@ -59,6 +66,21 @@ void Halt();
 /* Print an integer number to console */
 void PrintInt(int number);
 
+/* Save the state of the simulation to the file given by "nachos -ckpt",
+ * so that "nachos -restore" can carry on from here.  Returns 0 after
+ * saving, 1 when carrying on from the checkpoint, and -1 if no
+ * checkpoint could be taken.
+ */
+int Checkpoint();
+
+/* Start a copy of the running program, with the same memory and
+ * registers, carrying on from the call.  Return the child's SpaceId
+ * to the parent, and 0 to the child; -1 if no child could be started.
+ * The two share their pages until one of them writes a page, when it
+ * gets its own copy.
+ */
+int Fork();
+
 /*
  * Add the two operants and return the result
  */ 
@@ -155,6 +177,22 @@ int Seek(int position, OpenFileId id);
  */
 int Close(OpenFileId id);
 
+/* Map "length" bytes of the open file "id", from byte "offset" on, into
+ * the address space, and return the address they start at; -1 if the
+ * file isn't open or there is no room.  The pages are read from the
+ * file when first touched (as zeros, past its end), and whatever the
+ * program stores into them is written back to the file when they are
+ * paged out, or unmapped.  The mapping stays until it is unmapped, or
+ * the program exits, even if "id" is closed.  A Fork'ed child doesn't
+ * inherit it.  Only the stub file system supports it.
+ */
+int Mmap(OpenFileId id, int offset, int length);
+
+/* Unmap the mapping at "addr", returned by Mmap, writing back the
+ * pages that were changed.  Return 0, or -1 if nothing is mapped there.
+ */
+int Munmap(int addr);
+
 
 /* User-level thread operations: Fork and Yield.  To allow multiple
  * threads to run within a user program. 
@@ -0,0 +1,165 @@
+// tlbmanager.cc
+//	Routines to load and keep track of the entries of the machine's
+//	TLB, on behalf of user address spaces: see tlbmanager.h.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "tlbmanager.h"
+#include "addrspace.h"
+#include "main.h"
+
+//----------------------------------------------------------------------
+// TLBManager::TLBManager
+// 	Initialize the kernel's record of the TLB: no ID is in use, and
+//	each set starts replacing from its first entry.
+//----------------------------------------------------------------------
+
+TLBManager::TLBManager()
+{
+    Machine *machine = kernel->machine;
+    int numSets = machine->tlbSize / machine->tlbWays;
+
+    ASSERT(machine->tlb != NULL);
+    for (int i = 0; i < NumAsids; i++)
+	owner[i] = NULL;
+    nextVictim = new int[numSets];
+    for (int i = 0; i < numSets; i++)
+	nextVictim[i] = 0;
+}
+
+//----------------------------------------------------------------------
+// TLBManager::~TLBManager
+// 	De-allocate the kernel's record of the TLB.
+//----------------------------------------------------------------------
+
+TLBManager::~TLBManager()
+{
+    delete [] nextVictim;
+}
+
+//----------------------------------------------------------------------
+// TLBManager::AllocateAsid, TLBManager::FreeAsid
+// 	Hand out address-space IDs, and take them back.  An ID's entries
+//	are emptied out of the TLB when it is freed, so the next address
+//	space to get it can't hit in them.
+//----------------------------------------------------------------------
+
+int
+TLBManager::AllocateAsid(AddrSpace *space)
+{
+    for (int i = 0; i < NumAsids; i++)
+	if (owner[i] == NULL) {
+	    owner[i] = space;
+	    return i;
+	}
+    cerr << "Out of address-space IDs\n";
+    Abort();
+    return -1;
+}
+
+void
+TLBManager::FreeAsid(int asid)
+{
+    Machine *machine = kernel->machine;
+
+    for (int i = 0; i < machine->tlbSize; i++)
+	if (machine->tlbAsid[i] == asid) {
+	    machine->tlb[i].valid = FALSE;
+	    machine->tlbAsid[i] = -1;
+	}
+    owner[asid] = NULL;
+}
+
+//----------------------------------------------------------------------
+// TLBManager::Refill
+// 	Load page table "entry" of address space "asid" into the TLB: into
+//	an empty entry of its set if there is one, or else in place of the
+//	set's next victim, whose bits are first copied back.  The copy
+//	starts with the use and dirty bits clear; the access being retried
+//	sets them in the TLB.
+//----------------------------------------------------------------------
+
+void
+TLBManager::Refill(int asid, TranslationEntry *entry)
+{
+    Machine *machine = kernel->machine;
+    int first = machine->TLBSet(entry->virtualPage);
+    int set = first / machine->tlbWays;
+    int i;
+
+    for (i = first; i < first + machine->tlbWays; i++)
+	if (!machine->tlb[i].valid)
+	    break;
+    if (i == first + machine->tlbWays) {
+	i = first + nextVictim[set];
+	nextVictim[set] = (nextVictim[set] + 1) % machine->tlbWays;
+	WriteBack(i);
+    }
+    DEBUG(dbgAddr, "Loading TLB entry " << i << " with page " <<
+		entry->virtualPage << " of address space " << asid);
+    machine->tlb[i] = *entry;
+    machine->tlb[i].use = FALSE;
+    machine->tlb[i].dirty = FALSE;
+    machine->tlbAsid[i] = asid;
+}
+
+//----------------------------------------------------------------------
+// TLBManager::Sync, TLBManager::SyncAll
+// 	Bring the use and dirty bits in the page table of address space
+//	"asid" up to date with the TLB.  The use bit of a TLB entry is
+//	cleared once it is copied, so that clearing the bit in the page
+//	table still works: it is only set again if the page is used again.
+//	If "remove", the entry is taken out of the TLB altogether, as it
+//	must be before the page is paged out.
+//----------------------------------------------------------------------
+
+void
+TLBManager::Sync(int asid, int vpn, bool remove)
+{
+    Machine *machine = kernel->machine;
+    int first = machine->TLBSet(vpn);
+
+    for (int i = first; i < first + machine->tlbWays; i++)
+	if (machine->tlb[i].valid && (machine->tlbAsid[i] == asid) &&
+				(machine->tlb[i].virtualPage == vpn)) {
+	    WriteBack(i);
+	    if (remove) {
+		machine->tlb[i].valid = FALSE;
+		machine->tlbAsid[i] = -1;
+	    }
+	}
+}
+
+void
+TLBManager::SyncAll(int asid)
+{
+    Machine *machine = kernel->machine;
+
+    for (int i = 0; i < machine->tlbSize; i++)
+	if (machine->tlb[i].valid && (machine->tlbAsid[i] == asid))
+	    WriteBack(i);
+}
+
+//----------------------------------------------------------------------
+// TLBManager::WriteBack
+// 	Copy the use and dirty bits of valid TLB entry "i" into the page
+//	table entry it was loaded from, and clear its use bit.
+//----------------------------------------------------------------------
+
+void
+TLBManager::WriteBack(int i)
+{
+    TranslationEntry *tlbEntry = &kernel->machine->tlb[i];
+    TranslationEntry *entry;
+
+    if (!tlbEntry->valid)
+	return;
+    entry = owner[kernel->machine->tlbAsid[i]]->PageEntry(
+						tlbEntry->virtualPage);
+    entry->use |= tlbEntry->use;
+    entry->dirty |= tlbEntry->dirty;
+    tlbEntry->use = FALSE;
+}
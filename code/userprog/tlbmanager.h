@@ -0,0 +1,63 @@
+// tlbmanager.h
+//	Data structures for the kernel's side of a software-managed TLB.
+//
+//	With "-tlb <size> <ways>", the machine translates through a TLB
+//	instead of the running address space's page table, and a
+//	translation that misses in the TLB traps to the kernel, which
+//	loads it from the page table (paging it in first if need be: see
+//	AddrSpace::RefillTLB).  Each address space is given an ID, and
+//	each TLB entry is tagged with it, so the TLB keeps its entries
+//	across context switches.
+//
+//	The hardware sets the use and dirty bits in the TLB entry, not
+//	in the page table.  The kernel copies them back to the page table
+//	when an entry is replaced, and whenever it looks at a page's bits
+//	(see Sync), so the page replacement policies and PageOut see them.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef TLBMANAGER_H
+#define TLBMANAGER_H
+
+#include "copyright.h"
+#include "utility.h"
+#include "machine.h"
+
+class AddrSpace;
+
+// The following class defines the kernel's record of the TLB: which
+// address space has each ID, and which entry of each set to replace
+// next.
+
+class TLBManager {
+  public:
+    TLBManager();		// The machine's TLB must be enabled
+    ~TLBManager();
+
+    int AllocateAsid(AddrSpace *space);
+				// Return a free address-space ID for
+				// "space"
+    void FreeAsid(int asid);	// "asid" is not needed; empty its
+				// entries out of the TLB
+
+    void Refill(int asid, TranslationEntry *entry);
+				// Load a copy of page table entry "entry"
+				// of address space "asid" into the TLB
+    void Sync(int asid, int vpn, bool remove);
+				// Copy the use and dirty bits of any TLB
+				// entry for page "vpn" back to the page
+				// table, and take it out of the TLB if
+				// "remove"
+    void SyncAll(int asid);	// Sync every page of "asid"
+
+  private:
+    void WriteBack(int i);	// Copy TLB entry i's bits to its page
+
+    AddrSpace *owner[NumAsids];	// which address space has each ID
+    int *nextVictim;		// for each set, the entry to replace
+				// next, round robin
+};
+
+#endif // TLBMANAGER_H
@@ -47,3 +47,54 @@ struct scnhdr {
         long            s_flags;        /* flags */
       };
  
+
+/* The symbolic header, at f_symptr.  We only use it to find the
+ * external symbols and their names.
+ */
+typedef struct hdrr {
+        short   magic;          /* to verify validity of the table      */
+        short   vstamp;         /* version stamp                        */
+        long    ilineMax;       /* number of line number entries        */
+        long    cbLine;         /* number of bytes for line number entries */
+        long    cbLineOffset;   /* offset to start of line number entries */
+        long    idnMax;         /* max index into dense number table    */
+        long    cbDnOffset;     /* offset to start dense number table   */
+        long    ipdMax;         /* number of procedures                 */
+        long    cbPdOffset;     /* offset to procedure descriptor table */
+        long    isymMax;        /* number of local symbols              */
+        long    cbSymOffset;    /* offset to start of local symbols     */
+        long    ioptMax;        /* max index into optimization entries  */
+        long    cbOptOffset;    /* offset to optimization entries       */
+        long    iauxMax;        /* number of auxiliary symbol entries   */
+        long    cbAuxOffset;    /* offset to start of auxiliary entries */
+        long    issMax;         /* max index into local strings         */
+        long    cbSsOffset;     /* offset to start of local strings     */
+        long    issExtMax;      /* max index into external strings      */
+        long    cbSsExtOffset;  /* offset to start of external strings  */
+        long    ifdMax;         /* number of file descriptor entries    */
+        long    cbFdOffset;     /* offset to file descriptor table      */
+        long    crfd;           /* number of relative file descriptors  */
+        long    cbRfdOffset;    /* offset to relative file descriptors  */
+        long    iextMax;        /* max index into external symbols      */
+        long    cbExtOffset;    /* offset to start of external symbols  */
+      } HDRR;
+
+#define magicSym        0x7009
+
+/* An external symbol.  "st" and "sc" are packed into "bits" -- st in
+ * bits 0-5, sc in bits 6-10 -- to avoid depending on how the compiler
+ * lays out bit fields.
+ */
+typedef struct extr {
+        unsigned short  flags;  /* jmptbl, cobol_main, weakext          */
+        short   ifd;            /* where the symbol is defined          */
+        long    iss;            /* index into the external strings      */
+        long    value;          /* for procedures, the address          */
+        unsigned long bits;     /* st, sc, reserved, index              */
+      } EXTR;
+
+#define SymType(bits)   ((bits) & 0x3f)
+#define SymClass(bits)  (((bits) >> 6) & 0x1f)
+
+#define stProc          6       /* symbol type: a procedure             */
+#define scText          1       /* storage class: in .text              */
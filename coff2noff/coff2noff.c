@@ -148,6 +148,68 @@ void Write(int fd, char *buf, int nBytes)
     }
 }
 
+/* Copy the procedures in the COFF symbol table (if there is one) to
+ * the NOFF file, starting at "inNoffFile".  Names are left where they
+ * were in the external string table, which is copied whole.
+ */
+void WriteSymbols(int fdIn, int fdOut, struct filehdr *fileh, int inNoffFile)
+{
+    HDRR symh;
+    EXTR *externals;
+    NoffSymbolHeader noffSymH;
+    NoffSymbol *symbols;
+    char *names;
+    int i, numSymbols;
+
+    if (fileh->f_symptr == 0)
+	return;				/* stripped */
+    lseek(fdIn, WordToHost(fileh->f_symptr), 0);
+    ReadStruct(fdIn, symh);
+    if (ShortToHost(symh.magic) != magicSym) {
+	fprintf(stderr, "Ignoring unknown symbol table\n");
+	return;
+    }
+    symh.iextMax = WordToHost(symh.iextMax);
+    symh.cbExtOffset = WordToHost(symh.cbExtOffset);
+    symh.issExtMax = WordToHost(symh.issExtMax);
+    symh.cbSsExtOffset = WordToHost(symh.cbSsExtOffset);
+    if (symh.iextMax <= 0 || symh.issExtMax <= 0)
+	return;
+
+    externals = (EXTR *)malloc(symh.iextMax * sizeof(EXTR));
+    lseek(fdIn, symh.cbExtOffset, 0);
+    Read(fdIn, (char *) externals, symh.iextMax * sizeof(EXTR));
+    names = malloc(symh.issExtMax);
+    lseek(fdIn, symh.cbSsExtOffset, 0);
+    Read(fdIn, names, symh.issExtMax);
+
+    symbols = (NoffSymbol *)malloc(symh.iextMax * sizeof(NoffSymbol));
+    numSymbols = 0;
+    for (i = 0; i < symh.iextMax; i++) {
+	unsigned long bits = WordToHost(externals[i].bits);
+
+	if (SymType(bits) == stProc && SymClass(bits) == scText) {
+	    symbols[numSymbols].address = WordToMachine(
+					WordToHost(externals[i].value));
+	    symbols[numSymbols].name = WordToMachine(
+					WordToHost(externals[i].iss));
+	    numSymbols++;
+	}
+    }
+    printf("Copying %d procedure symbols\n", numSymbols);
+
+    noffSymH.symMagic = WordToMachine(NOFFSYMMAGIC);
+    noffSymH.numSymbols = WordToMachine(numSymbols);
+    noffSymH.stringSize = WordToMachine(symh.issExtMax);
+    lseek(fdOut, inNoffFile, 0);
+    Write(fdOut, (char *)&noffSymH, sizeof(NoffSymbolHeader));
+    Write(fdOut, (char *) symbols, numSymbols * sizeof(NoffSymbol));
+    Write(fdOut, names, symh.issExtMax);
+    free(externals);
+    free(names);
+    free(symbols);
+}
+
 int main(int argc, char **argv)
 {
     int fdIn, fdOut, numsections, i, inNoffFile;
@@ -287,6 +349,7 @@ int main(int argc, char **argv)
 	    exit(1);
 	}
     }
+    WriteSymbols(fdIn, fdOut, &fileh, inNoffFile);
     lseek(fdOut, 0, 0);
 
     // convert the NOFF header to little-endian before